@@ -14,7 +14,7 @@
         'VERSION=0.3.1',
       ],
       'sources': [
-        'src/atb.cc', 'src/glfw.cc'
+        'src/atb.cc', 'src/glfw.cc', 'src/mainthread.cc', 'src/renderer.cc'
       ],
       'include_dirs': [
         "<!(node -e \"require('nan')\")",
@@ -2,28 +2,172 @@ var GLFW = module.exports = require('bindings')('glfw');
 
 // Easy event emitter based event loop.  Started automatically when the first
 // listener is added.
+// Listeners are also registered in the native dispatch table
+// (AddEventListener) which calls them directly, so the emitter is only a
+// compatibility facade and emit() is never used for GLFW events.
+// The Float64Array of an 'events' batch (see SetEventQueue) is reused by the
+// next batch, copy it to keep records past the listener call.
+function facade(add, remove, removeAll) {
+  var EventEmitter = require('events').EventEmitter;
+  var emitter = new EventEmitter;
+
+  emitter.on = emitter.addListener = function(type, listener) {
+    add(type, listener);
+    return EventEmitter.prototype.addListener.call(this, type, listener);
+  };
+
+  emitter.once = function(type, listener) {
+    var self = this;
+    function g(evt) {
+      self.removeListener(type, g);
+      listener(evt);
+    }
+    g.listener = listener;
+    return this.on(type, g);
+  };
+
+  emitter.removeListener = function(type, listener) {
+    var fns = this.rawListeners ? this.rawListeners(type) : this.listeners(type);
+    for (var i = fns.length - 1; i >= 0; i--) {
+      if (fns[i] === listener || fns[i].listener === listener) {
+        remove(type, fns[i]);
+        break;
+      }
+    }
+    return EventEmitter.prototype.removeListener.call(this, type, listener);
+  };
+
+  emitter.removeAllListeners = function(type) {
+    removeAll(type);
+    return EventEmitter.prototype.removeAllListeners.apply(this, arguments);
+  };
+  return emitter;
+}
+
 var events;
 Object.defineProperty(GLFW, 'events', {
   get: function () {
-    if (events) return events;
-    events = new (require('events').EventEmitter);
-
-    var _emit=events.emit;
-    events.emit=function() {
-      var args = Array.prototype.slice.call(arguments);
-      var evt= args[1]; // args[1] is the event, args[0] is the type of event
-      //console.log("emitting event: "+require('util').inspect(args));
-      if(args[0] != 'quit') {
-        evt.preventDefault = function () {};
-        evt.stopPropagation = function () {};
-      }
-      //_emit.apply(this,args);
-      events.listeners(args[0]).forEach(function(listener) {
-        listener(args[1]);
-      });
-    };
+    if (!events)
+      events = facade(GLFW.AddEventListener, GLFW.RemoveEventListener,
+                      GLFW.RemoveAllEventListeners);
     return events;
   },
   enumerable: true,
   configurable: true
 });
+
+// Events of a single window, called after the global listeners. The emitter
+// is dropped along with the window's native listeners in DestroyWindow.
+var windowEvents = {};
+GLFW.windowEvents = function(window) {
+  var emitter = windowEvents[window];
+  if (emitter) return emitter;
+  return windowEvents[window] = facade(
+    function(type, fn) { GLFW.AddWindowEventListener(window, type, fn); },
+    function(type, fn) { GLFW.RemoveWindowEventListener(window, type, fn); },
+    function(type) { GLFW.RemoveAllWindowEventListeners(window, type); });
+};
+
+var destroyWindow = GLFW.DestroyWindow;
+GLFW.DestroyWindow = function(window) {
+  delete windowEvents[window];
+  return destroyWindow.apply(this, arguments);
+};
+
+// Records frames for a window whose context lives on a render thread, see
+// StartRenderThread. The buffer grows as needed and is reused across frames.
+function CommandBuffer(size) {
+  this.data = new Float64Array(size || 256);
+  this.length = 0;
+}
+
+CommandBuffer.prototype.push = function() {
+  if (this.length + arguments.length > this.data.length) {
+    var data = new this.data.constructor(Math.max(this.data.length * 2, this.length + arguments.length));
+    data.set(this.data.subarray(0, this.length));
+    this.data = data;
+  }
+  for (var i = 0; i < arguments.length; i++)
+    this.data[this.length++] = arguments[i];
+  return this;
+};
+
+CommandBuffer.prototype.viewport = function(x, y, width, height) {
+  return this.push(GLFW.RENDER_VIEWPORT, x, y, width, height);
+};
+CommandBuffer.prototype.clearColor = function(r, g, b, a) {
+  return this.push(GLFW.RENDER_CLEAR_COLOR, r, g, b, a);
+};
+CommandBuffer.prototype.clear = function(mask) {
+  return this.push(GLFW.RENDER_CLEAR, mask);
+};
+CommandBuffer.prototype.testScene = function(width, height, z) {
+  return this.push(GLFW.RENDER_TEST_SCENE, width, height, z || 0);
+};
+CommandBuffer.prototype.swapInterval = function(interval) {
+  return this.push(GLFW.RENDER_SWAP_INTERVAL, interval);
+};
+CommandBuffer.prototype.swap = function() {
+  return this.push(GLFW.RENDER_SWAP);
+};
+
+// hand the recorded frame to the render thread and start a new one,
+// onDone(frame) is called once the thread has executed it
+CommandBuffer.prototype.submit = function(window, onDone) {
+  var frame = onDone ? GLFW.SubmitCommands(window, this.data, this.length, onDone)
+                     : GLFW.SubmitCommands(window, this.data, this.length);
+  this.length = 0;
+  return frame;
+};
+
+GLFW.CommandBuffer = CommandBuffer;
+
+// Records window management commands (see ExecuteWindowCommands) so a
+// relayout of many windows runs in a single call.
+function WindowCommandBuffer(size) {
+  this.data = new Int32Array(size || 256);
+  this.length = 0;
+  this.count = 0;
+  this.titles = [];
+}
+
+WindowCommandBuffer.prototype.push = CommandBuffer.prototype.push;
+
+WindowCommandBuffer.prototype.command = function() {
+  this.count++;
+  return this.push.apply(this, arguments);
+};
+
+WindowCommandBuffer.prototype.pos = function(window, x, y) {
+  return this.command(GLFW.WINDOW_CMD_POS, window, x, y);
+};
+WindowCommandBuffer.prototype.size = function(window, width, height) {
+  return this.command(GLFW.WINDOW_CMD_SIZE, window, width, height);
+};
+WindowCommandBuffer.prototype.title = function(window, title) {
+  this.titles.push(title);
+  return this.command(GLFW.WINDOW_CMD_TITLE, window, this.titles.length - 1);
+};
+WindowCommandBuffer.prototype.show = function(window) {
+  return this.command(GLFW.WINDOW_CMD_SHOW, window);
+};
+WindowCommandBuffer.prototype.hide = function(window) {
+  return this.command(GLFW.WINDOW_CMD_HIDE, window);
+};
+WindowCommandBuffer.prototype.iconify = function(window) {
+  return this.command(GLFW.WINDOW_CMD_ICONIFY, window);
+};
+WindowCommandBuffer.prototype.restore = function(window) {
+  return this.command(GLFW.WINDOW_CMD_RESTORE, window);
+};
+
+// run the recorded commands and start over, out (an Int32Array with one
+// entry per command) tells which windows were still alive
+WindowCommandBuffer.prototype.execute = function(out) {
+  var done = GLFW.ExecuteWindowCommands(this.data, this.length, this.titles, out);
+  this.length = this.count = 0;
+  this.titles = [];
+  return done;
+};
+
+GLFW.WindowCommandBuffer = WindowCommandBuffer;
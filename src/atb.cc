@@ -1,4 +1,5 @@
 #include "atb.h"
+#include "window.h"
 
 #include <cstring>
 #include <iostream>
@@ -70,17 +71,20 @@ AntTweakBar::AntTweakBar(Handle<Object> wrapper)
 
 AntTweakBar::~AntTweakBar () {
   TwTerminate();
+  glfw::SetTweakBarInput(false);
 }
 
 NAN_METHOD(AntTweakBar::Init) {
   NanScope();
   TwInit(TW_OPENGL, NULL);
+  glfw::SetTweakBarInput(true);
   NanReturnUndefined();
 }
 
 NAN_METHOD(AntTweakBar::Terminate) {
   NanScope();
   TwTerminate();
+  glfw::SetTweakBarInput(false);
   NanReturnUndefined();
 }
 
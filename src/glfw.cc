@@ -1,9 +1,31 @@
 #include "common.h"
 #include "atb.h"
+#include "input.h"
+#include "window.h"
+#include "pacing.h"
+#include "mainthread.h"
 
 // Includes
+#include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// the X11 connection is watched by libuv, see StartEventWatcher
+#if defined(__linux__)
+#define GLFW_EXPOSE_NATIVE_X11
+#include <GLFW/glfw3native.h>
+#endif
 
 using namespace v8;
 using namespace node;
@@ -22,8 +44,14 @@ NAN_METHOD(Init) {
   NanReturnValue(JS_BOOL(glfwInit()==1));
 }
 
+void StopWatcher();
+void ReleaseWindowPool();
+
 NAN_METHOD(Terminate) {
   NanScope();
+  StopWatcher();
+  ReleaseWindowStates();
+  ReleaseWindowPool();
   glfwTerminate();
   NanReturnUndefined();
 }
@@ -47,9 +75,13 @@ NAN_METHOD(GetVersionString) {
 
 /* @Module: Time input */
 
+/*
+ * Hot getters (GetTime, GetKey, GetMouseButton, WindowShouldClose,
+ * JoystickPresent) skip NanScope and return primitives, so a call allocates
+ * no handles. Only the invalid window path creates any.
+ */
 NAN_METHOD(GetTime) {
-  NanScope();
-  NanReturnValue(JS_NUM(glfwGetTime()));
+  NanReturnValue(glfwGetTime());
 }
 
 NAN_METHOD(SetTime) {
@@ -113,128 +145,31 @@ NAN_METHOD(GetMonitors) {
 }
 
 /* @Module: Window handling */
-Persistent<Object> glfw_events;
-int lastX=0,lastY=0;
-bool windowCreated=false;
-
-void NAN_INLINE(CallEmitter(int argc, Handle<Value> argv[])) {
-  NanScope();
-  // MakeCallback(glfw_events, "emit", argc, argv);
-  if(NanNew(glfw_events)->Has(NanSymbol("emit"))) {
-    Local<Function> callback = NanNew(glfw_events)->Get(NanSymbol("emit")).As<Function>();
-
-    if (!callback.IsEmpty()) {
-      callback->Call(NanGetCurrentContext()->Global(),argc,argv);
-    }
-  }
-}
-
-/* Window callbacks handling */
-void APIENTRY windowPosCB(GLFWwindow *window, int xpos, int ypos) {
-  NanScope();
-  //cout<<"resizeCB: "<<w<<" "<<h<<endl;
-
-  Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),3);
-  evt->Set(JS_STR("type"),JS_STR("window_pos"));
-  evt->Set(JS_STR("xpos"),JS_INT(xpos));
-  evt->Set(JS_STR("ypos"),JS_INT(ypos));
-
-  Handle<Value> argv[2] = {
-    JS_STR("window_pos"), // event name
-    evt
-  };
-
-  CallEmitter(2, argv);
-}
-
-void APIENTRY windowSizeCB(GLFWwindow *window, int w, int h) {
-  NanScope();
-  //cout<<"resizeCB: "<<w<<" "<<h<<endl;
-
-  Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),3);
-  evt->Set(JS_STR("type"),JS_STR("resize"));
-  evt->Set(JS_STR("width"),JS_INT(w));
-  evt->Set(JS_STR("height"),JS_INT(h));
-
-  Handle<Value> argv[2] = {
-    JS_STR("resize"), // event name
-    evt
-  };
-
-  CallEmitter(2, argv);
-}
-
-void APIENTRY windowFramebufferSizeCB(GLFWwindow *window, int w, int h) {
-  NanScope();
-  //cout<<"resizeCB: "<<w<<" "<<h<<endl;
-
-  Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),3);
-  evt->Set(JS_STR("type"),JS_STR("framebuffer_resize"));
-  evt->Set(JS_STR("width"),JS_INT(w));
-  evt->Set(JS_STR("height"),JS_INT(h));
-
-  Handle<Value> argv[2] = {
-    JS_STR("framebuffer_resize"), // event name
-    evt
-  };
-
-  CallEmitter(2, argv);
-}
-
-void APIENTRY windowCloseCB(GLFWwindow *window) {
-  NanScope();
-
-  Handle<Value> argv[1] = {
-    JS_STR("quit"), // event name
-  };
-
-  CallEmitter(2, argv);
-}
-
-void APIENTRY windowRefreshCB(GLFWwindow *window) {
-  NanScope();
-
-  Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),2);
-  evt->Set(JS_STR("type"),JS_STR("refresh"));
-  evt->Set(JS_STR("window"),JS_NUM((uint64_t) window));
-
-  Handle<Value> argv[2] = {
-    JS_STR("refresh"), // event name
-    evt
-  };
-
-  CallEmitter(2, argv);
-}
-
-void APIENTRY windowIconifyCB(GLFWwindow *window, int iconified) {
-  NanScope();
-
-  Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),2);
-  evt->Set(JS_STR("type"),JS_STR("iconified"));
-  evt->Set(JS_STR("iconified"),JS_BOOL(iconified));
-
-  Handle<Value> argv[2] = {
-    JS_STR("iconified"), // event name
-    evt
-  };
-
-  CallEmitter(2, argv);
-}
-
-void APIENTRY windowFocusCB(GLFWwindow *window, int focused) {
-  NanScope();
-
-  Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),2);
-  evt->Set(JS_STR("type"),JS_STR("focused"));
-  evt->Set(JS_STR("focused"),JS_BOOL(focused));
-
-  Handle<Value> argv[2] = {
-    JS_STR("focused"), // event name
-    evt
-  };
-
-  CallEmitter(2, argv);
-}
+WindowRegistry windowRegistry;
+
+// window of a JS handle, 0/undefined are ignored like before, stale handles throw
+#define REQ_WINDOW(handle, window)                                      \
+  GLFWwindow *window=windowRegistry.Get(handle);                        \
+  if(!window)                                                           \
+    return NanThrowError("Invalid window handle");
+
+// when set, callbacks only store records and PollEvents/WaitEvents hand the
+// whole batch to JS as a single 'events' event. Its Float64Array is reused,
+// it is only valid during the listener call
+bool queueEvents=false;
+EventQueue eventQueue;
+EventStats eventStats;
+
+// per event kind coalescing, see SetEventCoalescing()
+int coalescePolicy[EVENT_TYPE_COUNT]={ COALESCE_NONE };
+bool coalesceHistory[EVENT_TYPE_COUNT]={ false };
+CoalescedEvent coalesced[EVENT_TYPE_COUNT];
+
+// storage backing the Float64Array handed out with each batch
+InputEvent *batchData=NULL;
+size_t batchCapacity=0;
+Persistent<ArrayBuffer> batchBuffer;
+bool flushingBatch=false;
 
 static int jsKeyCode[]={
 /*GLFW_KEY_ESCAPE*/       27,
@@ -309,611 +244,2801 @@ static int jsKeyCode[]={
 /*GLFW_KEY_MENU*/         18
 };
 
-void APIENTRY keyCB(GLFWwindow *window, int key, int scancode, int action, int mods) {
-  const char *actionNames = "keyup\0  keydown\0keypress";
+static int jsKeyCodeOf(int key) {
+  if(key>=GLFW_KEY_ESCAPE && key<=GLFW_KEY_LAST)
+    key=jsKeyCode[key-GLFW_KEY_ESCAPE];
+  else if(key==GLFW_KEY_SEMICOLON)  key=186;    // ;
+  else if(key==GLFW_KEY_EQUAL)  key=187;        // =
+  else if(key==GLFW_KEY_COMMA)  key=188;        // ,
+  else if(key==GLFW_KEY_MINUS)  key=189;        // -
+  else if(key==GLFW_KEY_PERIOD)  key=190;       // .
+  else if(key==GLFW_KEY_SLASH)  key=191;        // /
+  else if(key==GLFW_KEY_GRAVE_ACCENT)  key=192; // `
+  else if(key==GLFW_KEY_LEFT_BRACKET)  key=219; // [
+  else if(key==GLFW_KEY_BACKSLASH)  key=220;    /* \ */
+  else if(key==GLFW_KEY_RIGHT_BRACKET)  key=221;// ]
+  else if(key==GLFW_KEY_APOSTROPHE)  key=222;   // '
+  return key;
+}
 
-  if(!TwEventKeyGLFW(key,action)) {
-    NanScope();
+static const char *eventNames[EVENT_TYPE_COUNT] = {
+  "window_pos",
+  "resize",
+  "framebuffer_resize",
+  "quit",
+  "refresh",
+  "iconified",
+  "focused",
+  "keyup",
+  "keydown",
+  "keypress",
+  "mousemove",
+  "mouseenter",
+  "mousedown",
+  "mouseup",
+  "mousewheel"
+};
+
+/* Event object shapes */
+enum EventProp {
+  PROP_TYPE = 0,
+  PROP_XPOS, PROP_YPOS,
+  PROP_WIDTH, PROP_HEIGHT,
+  PROP_WINDOW,
+  PROP_ICONIFIED, PROP_FOCUSED,
+  PROP_CTRLKEY, PROP_SHIFTKEY, PROP_ALTKEY, PROP_METAKEY,
+  PROP_WHICH, PROP_KEYCODE, PROP_CHARCODE,
+  PROP_PAGEX, PROP_PAGEY, PROP_X, PROP_Y,
+  PROP_ENTERED, PROP_BUTTON,
+  PROP_WHEELDELTAX, PROP_WHEELDELTAY, PROP_WHEELDELTA,
+  PROP_SAMPLES,
+  PROP_TIME,
+  PROP_COUNT
+};
+
+static const char *propNames[PROP_COUNT] = {
+  "type",
+  "xpos", "ypos",
+  "width", "height",
+  "window",
+  "iconified", "focused",
+  "ctrlKey", "shiftKey", "altKey", "metaKey",
+  "which", "keyCode", "charCode",
+  "pageX", "pageY", "x", "y",
+  "entered", "button",
+  "wheelDeltaX", "wheelDeltaY", "wheelDelta",
+  "samples",
+  "time"
+};
+
+// properties of each event kind, in creation order, -1 terminated
+static const int eventProps[EVENT_TYPE_COUNT][10] = {
+  /* window_pos */         { PROP_XPOS, PROP_YPOS, PROP_SAMPLES, PROP_WINDOW, PROP_TIME, -1 },
+  /* resize */             { PROP_WIDTH, PROP_HEIGHT, PROP_SAMPLES, PROP_WINDOW, PROP_TIME, -1 },
+  /* framebuffer_resize */ { PROP_WIDTH, PROP_HEIGHT, PROP_SAMPLES, PROP_WINDOW, PROP_TIME, -1 },
+  /* quit */               { PROP_TIME, -1 },
+  /* refresh */            { PROP_WINDOW, PROP_TIME, -1 },
+  /* iconified */          { PROP_ICONIFIED, PROP_WINDOW, PROP_TIME, -1 },
+  /* focused */            { PROP_FOCUSED, PROP_WINDOW, PROP_TIME, -1 },
+  /* keyup */              { PROP_CTRLKEY, PROP_SHIFTKEY, PROP_ALTKEY, PROP_METAKEY, PROP_WHICH, PROP_KEYCODE, PROP_CHARCODE, PROP_WINDOW, PROP_TIME, -1 },
+  /* keydown */            { PROP_CTRLKEY, PROP_SHIFTKEY, PROP_ALTKEY, PROP_METAKEY, PROP_WHICH, PROP_KEYCODE, PROP_CHARCODE, PROP_WINDOW, PROP_TIME, -1 },
+  /* keypress */           { PROP_CTRLKEY, PROP_SHIFTKEY, PROP_ALTKEY, PROP_METAKEY, PROP_WHICH, PROP_KEYCODE, PROP_CHARCODE, PROP_WINDOW, PROP_TIME, -1 },
+  /* mousemove */          { PROP_PAGEX, PROP_PAGEY, PROP_X, PROP_Y, PROP_SAMPLES, PROP_WINDOW, PROP_TIME, -1 },
+  /* mouseenter */         { PROP_ENTERED, PROP_WINDOW, PROP_TIME, -1 },
+  /* mousedown */          { PROP_BUTTON, PROP_WHICH, PROP_X, PROP_Y, PROP_PAGEX, PROP_PAGEY, PROP_WINDOW, PROP_TIME, -1 },
+  /* mouseup */            { PROP_BUTTON, PROP_WHICH, PROP_X, PROP_Y, PROP_PAGEX, PROP_PAGEY, PROP_WINDOW, PROP_TIME, -1 },
+  /* mousewheel */         { PROP_WHEELDELTAX, PROP_WHEELDELTAY, PROP_WHEELDELTA, PROP_SAMPLES, PROP_WINDOW, PROP_TIME, -1 }
+};
 
-    Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),7);
-    evt->Set(JS_STR("type"), JS_STR( &actionNames[action << 3] ));
-    evt->Set(JS_STR("ctrlKey"),JS_BOOL(mods & GLFW_MOD_CONTROL));
-    evt->Set(JS_STR("shiftKey"),JS_BOOL(mods & GLFW_MOD_SHIFT));
-    evt->Set(JS_STR("altKey"),JS_BOOL(mods & GLFW_MOD_ALT));
-    evt->Set(JS_STR("metaKey"),JS_BOOL(mods & GLFW_MOD_SUPER));
+static inline bool isBoolProp(int prop) {
+  return (prop>=PROP_ICONIFIED && prop<=PROP_METAKEY);
+}
 
-    int which=key, charCode=key;
+// interned names and one template per event kind, built once in InitEvents()
+Persistent<String> propSymbols[PROP_COUNT];
+Persistent<String> eventSymbols[EVENT_TYPE_COUNT];
+Persistent<ObjectTemplate> eventTemplates[EVENT_TYPE_COUNT];
 
-    if(key>=GLFW_KEY_ESCAPE && key<=GLFW_KEY_LAST)
-      key=jsKeyCode[key-GLFW_KEY_ESCAPE];
-    else if(key==GLFW_KEY_SEMICOLON)  key=186;    // ;
-    else if(key==GLFW_KEY_EQUAL)  key=187;        // =
-    else if(key==GLFW_KEY_COMMA)  key=188;        // ,
-    else if(key==GLFW_KEY_MINUS)  key=189;        // -
-    else if(key==GLFW_KEY_PERIOD)  key=190;       // .
-    else if(key==GLFW_KEY_SLASH)  key=191;        // /
-    else if(key==GLFW_KEY_GRAVE_ACCENT)  key=192; // `
-    else if(key==GLFW_KEY_LEFT_BRACKET)  key=219; // [
-    else if(key==GLFW_KEY_BACKSLASH)  key=220;    /* \ */
-    else if(key==GLFW_KEY_RIGHT_BRACKET)  key=221;// ]
-    else if(key==GLFW_KEY_APOSTROPHE)  key=222;   // '
+// when set, a single mutable object per event kind is handed to listeners
+bool reuseEvents=false;
+Persistent<Object> eventObjects[EVENT_TYPE_COUNT];
 
-    evt->Set(JS_STR("which"),JS_INT(which));
-    evt->Set(JS_STR("keyCode"),JS_INT(key));
-    evt->Set(JS_STR("charCode"),JS_INT(charCode));
+/*
+ * Native listener registry. Handlers are called straight from C++, one list
+ * per event kind plus one for the queued 'events' batch.
+ */
+#define LISTENER_BATCH EVENT_TYPE_COUNT
 
-    Handle<Value> argv[2] = {
-      JS_STR(&actionNames[action << 3]), // event name
-      evt
-    };
+ListenerList listeners[EVENT_TYPE_COUNT+1];
 
-    CallEmitter(2, argv);
+static int listenerSlot(const char *name) {
+  for(int type=0; type<EVENT_TYPE_COUNT; type++) {
+    if(!strcmp(name, eventNames[type]))
+      return type;
   }
+  if(!strcmp(name, "events"))
+    return LISTENER_BATCH;
+  return -1;
 }
 
-void APIENTRY cursorPosCB(GLFWwindow* window, double x, double y) {
-  if(!TwEventMousePosGLFW(x,y)) {
-    int w,h;
-    glfwGetWindowSize(window, &w, &h);
-    if(x<0 || x>=w) return;
-    if(y<0 || y>=h) return;
-
-    lastX=x;
-    lastY=y;
+// drop entries removed while the list was being dispatched
+static void compactListeners(ListenerList &list) {
+  size_t n=0;
+  for(size_t i=0; i<list.fns.size(); i++) {
+    if(list.fns[i])
+      list.fns[n++]=list.fns[i];
+  }
+  list.fns.resize(n);
+}
 
-    NanScope();
+static inline bool hasListeners(int slot) {
+  return !listeners[slot].Empty();
+}
 
-    Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),5);
-    evt->Set(JS_STR("type"),JS_STR("mousemove"));
-    evt->Set(JS_STR("pageX"),JS_INT(x));
-    evt->Set(JS_STR("pageY"),JS_INT(y));
-    evt->Set(JS_STR("x"),JS_INT(x));
-    evt->Set(JS_STR("y"),JS_INT(y));
+// a window's own list goes away with the window, handle is then checked
+// after each listener
+void CallListeners(ListenerList &list, int argc, Handle<Value> argv[], int handle=0) {
+  if(list.fns.empty()) return;
+  NanScope();
 
-    Handle<Value> argv[2] = {
-      JS_STR("mousemove"), // event name
-      evt
-    };
+  Local<Object> global=NanGetCurrentContext()->Global();
 
-    CallEmitter(2, argv);
+  // listeners added during dispatch only see the next event
+  size_t count=list.fns.size();
+  list.dispatching++;
+  for(size_t i=0; i<count; i++) {
+    if(list.fns[i])
+      NanNew(*list.fns[i])->Call(global, argc, argv);
+    if(handle && !windowRegistry.Get(handle))
+      return;
   }
+  if(--list.dispatching==0)
+    compactListeners(list);
 }
 
-void APIENTRY cursorEnterCB(GLFWwindow* window, int entered) {
+void CallListeners(int slot, int argc, Handle<Value> argv[]) {
+  CallListeners(listeners[slot], argc, argv);
+}
+
+NAN_METHOD(EventNoop) {
   NanScope();
+  NanReturnUndefined();
+}
 
-  Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),2);
-  evt->Set(JS_STR("type"),JS_STR("mouseenter"));
-  evt->Set(JS_STR("entered"),JS_INT(entered));
+void InitEvents() {
+  NanScope();
+  for(int i=0; i<PROP_COUNT; i++)
+    NanAssignPersistent(propSymbols[i], NanSymbol(propNames[i]));
+
+  // DOM compatibility, shared by all event objects
+  Local<FunctionTemplate> noop=FunctionTemplate::New(v8::Isolate::GetCurrent(), EventNoop);
+
+  for(int type=0; type<EVENT_TYPE_COUNT; type++) {
+    NanAssignPersistent(eventSymbols[type], NanSymbol(eventNames[type]));
+
+    Local<ObjectTemplate> tmpl=ObjectTemplate::New();
+    tmpl->Set(NanNew(propSymbols[PROP_TYPE]), NanNew(eventSymbols[type]));
+    tmpl->Set(JS_STR("preventDefault"), noop);
+    tmpl->Set(JS_STR("stopPropagation"), noop);
+    for(const int *prop=eventProps[type]; *prop>=0; prop++) {
+      if(*prop==PROP_SAMPLES)
+        tmpl->Set(NanNew(propSymbols[*prop]), NanNull());
+      else if(isBoolProp(*prop))
+        tmpl->Set(NanNew(propSymbols[*prop]), JS_BOOL(false));
+      else
+        tmpl->Set(NanNew(propSymbols[*prop]), JS_INT(0));
+    }
+    NanAssignPersistent(eventTemplates[type], tmpl);
+  }
+}
 
-  Handle<Value> argv[2] = {
-    JS_STR("mouseenter"), // event name
-    evt
-  };
+Local<Object> NewEventObject(int type) {
+  if(!reuseEvents)
+    return NanNew(eventTemplates[type])->NewInstance();
 
-  CallEmitter(2, argv);
+  if(eventObjects[type].IsEmpty())
+    NanAssignPersistent(eventObjects[type], NanNew(eventTemplates[type])->NewInstance());
+  return NanNew(eventObjects[type]);
 }
 
-void APIENTRY mouseButtonCB(GLFWwindow *window, int button, int action, int mods) {
-   if(!TwEventMouseButtonGLFW(button,action)) {
-    NanScope();
-    Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),7);
-    evt->Set(JS_STR("type"),JS_STR(action ? "mousedown" : "mouseup"));
-    evt->Set(JS_STR("button"),JS_INT(button));
-    evt->Set(JS_STR("which"),JS_INT(button));
-    evt->Set(JS_STR("x"),JS_INT(lastX));
-    evt->Set(JS_STR("y"),JS_INT(lastY));
-    evt->Set(JS_STR("pageX"),JS_INT(lastX));
-    evt->Set(JS_STR("pageY"),JS_INT(lastY));
+#define EVT_SET(prop, val) evt->Set(NanNew(propSymbols[prop]), val)
 
-    Handle<Value> argv[2] = {
-      JS_STR(action ? "mousedown" : "mouseup"), // event name
-      evt
-    };
+/* Raw coalesced samples as a Float64Array of (a,b) pairs */
+Local<Float64Array> NewSampleArray(const std::vector<double> &samples) {
+  size_t n=samples.size();
+  Local<Float64Array> arr=Float64Array::New(ArrayBuffer::New(v8::Isolate::GetCurrent(), n*sizeof(double)), 0, n);
+  for(size_t i=0; i<n; i++)
+    arr->Set(i, JS_NUM(samples[i]));
+  return arr;
+}
 
-    CallEmitter(2, argv);
-  }
+static inline WindowState *recordState(const InputEvent &rec) {
+  GLFWwindow *window=windowRegistry.Get((int) rec.window);
+  return window ? GetWindowState(window) : NULL;
 }
 
-void APIENTRY scrollCB(GLFWwindow *window, double xoffset, double yoffset) {
-  if(!TwEventMouseWheelGLFW(yoffset)) {
-    NanScope();
+/* Remember the newest input JS got for the latency tracker */
+static inline void consumed(const InputEvent &rec, WindowState *state=NULL) {
+  if(!state)
+    state=recordState(rec);
+  if(state && rec.time>state->newestInput)
+    state->newestInput=rec.time;
+}
 
-    Local<Array> evt=Array::New(v8::Isolate::GetCurrent(),3);
-    evt->Set(JS_STR("type"),JS_STR("mousewheel"));
-    evt->Set(JS_STR("wheelDeltaX"),JS_INT(xoffset*120));
-    evt->Set(JS_STR("wheelDeltaY"),JS_INT(yoffset*120));
-    evt->Set(JS_STR("wheelDelta"),JS_INT(yoffset*120));
+/*
+ * Build the JS event object for a record and emit it to the global listeners
+ * (unless the record is queued for them) and to the window's own listeners.
+ */
+void DispatchEvent(const InputEvent &rec, const std::vector<double> *samples=NULL, bool global=true) {
+  int type=(int) rec.type;
+  int handle=(int) rec.window;
+  WindowState *state=recordState(rec);
+  bool toGlobal=global && hasListeners(type);
+  bool toWindow=state && !state->listeners[type].Empty();
+  if(!toGlobal && !toWindow) return;
+  NanScope();
 
-    Handle<Value> argv[2] = {
-      JS_STR("mousewheel"), // event name
-      evt
-    };
+  consumed(rec, state);
 
-    CallEmitter(2, argv);
+  if(type==EVENT_QUIT) {
+    if(toGlobal)
+      CallListeners(type, 0, NULL);
+    if(toWindow && windowRegistry.Get(handle))
+      CallListeners(state->listeners[type], 0, NULL, handle);
+    return;
   }
-}
 
-int APIENTRY windowCloseCB() {
-  NanScope();
+  Local<Object> evt=NewEventObject(type);
+  EVT_SET(PROP_TIME, JS_NUM(rec.time));
+
+  switch(type) {
+  case EVENT_WINDOW_POS:
+    EVT_SET(PROP_XPOS, JS_INT(rec.a));
+    EVT_SET(PROP_YPOS, JS_INT(rec.b));
+    break;
+  case EVENT_RESIZE:
+  case EVENT_FRAMEBUFFER_RESIZE:
+    EVT_SET(PROP_WIDTH, JS_INT(rec.a));
+    EVT_SET(PROP_HEIGHT, JS_INT(rec.b));
+    break;
+  case EVENT_ICONIFIED:
+    EVT_SET(PROP_ICONIFIED, JS_BOOL(rec.a));
+    break;
+  case EVENT_FOCUSED:
+    EVT_SET(PROP_FOCUSED, JS_BOOL(rec.a));
+    break;
+  case EVENT_KEYUP:
+  case EVENT_KEYDOWN:
+  case EVENT_KEYPRESS: {
+    int key=(int) rec.a, mods=(int) rec.c;
+    EVT_SET(PROP_CTRLKEY, JS_BOOL(mods & GLFW_MOD_CONTROL));
+    EVT_SET(PROP_SHIFTKEY, JS_BOOL(mods & GLFW_MOD_SHIFT));
+    EVT_SET(PROP_ALTKEY, JS_BOOL(mods & GLFW_MOD_ALT));
+    EVT_SET(PROP_METAKEY, JS_BOOL(mods & GLFW_MOD_SUPER));
+    EVT_SET(PROP_WHICH, JS_INT(key));
+    EVT_SET(PROP_KEYCODE, JS_INT(jsKeyCodeOf(key)));
+    EVT_SET(PROP_CHARCODE, JS_INT(key));
+    break;
+  }
+  case EVENT_MOUSEMOVE:
+    EVT_SET(PROP_PAGEX, JS_INT(rec.a));
+    EVT_SET(PROP_PAGEY, JS_INT(rec.b));
+    EVT_SET(PROP_X, JS_INT(rec.a));
+    EVT_SET(PROP_Y, JS_INT(rec.b));
+    break;
+  case EVENT_MOUSEENTER:
+    EVT_SET(PROP_ENTERED, JS_INT(rec.a));
+    break;
+  case EVENT_MOUSEDOWN:
+  case EVENT_MOUSEUP:
+    EVT_SET(PROP_BUTTON, JS_INT(rec.a));
+    EVT_SET(PROP_WHICH, JS_INT(rec.a));
+    EVT_SET(PROP_X, JS_INT(rec.c));
+    EVT_SET(PROP_Y, JS_INT(rec.d));
+    EVT_SET(PROP_PAGEX, JS_INT(rec.c));
+    EVT_SET(PROP_PAGEY, JS_INT(rec.d));
+    break;
+  case EVENT_MOUSEWHEEL:
+    EVT_SET(PROP_WHEELDELTAX, JS_INT(rec.a*120));
+    EVT_SET(PROP_WHEELDELTAY, JS_INT(rec.b*120));
+    EVT_SET(PROP_WHEELDELTA, JS_INT(rec.b*120));
+    break;
+  }
+
+  if(isCoalescible(type)) {
+    if(samples)
+      EVT_SET(PROP_SAMPLES, NewSampleArray(*samples));
+    else
+      EVT_SET(PROP_SAMPLES, NanNull());
+  }
+
+  EVT_SET(PROP_WINDOW, JS_INT(handle));
 
   Handle<Value> argv[1] = {
-    JS_STR("quit"), // event name
+    evt
   };
 
-  CallEmitter(1, argv);
+  if(toGlobal)
+    CallListeners(type, 1, argv);
+  // global listeners may have destroyed the window
+  if(toWindow && windowRegistry.Get(handle))
+    CallListeners(state->listeners[type], 1, argv, handle);
+}
 
-  return 1;
+/* Queue the record or dispatch it right away */
+void DeliverEvent(const InputEvent &rec, const std::vector<double> *samples=NULL) {
+  if(queueEvents) {
+    eventQueue.Push(rec, eventStats);
+    DispatchEvent(rec, samples, false);
+  }
+  else
+    DispatchEvent(rec, samples);
 }
 
-NAN_METHOD(testJoystick) {
-  NanScope();
+void FlushCoalesced(int type) {
+  CoalescedEvent &pending=coalesced[type];
+  if(!pending.pending) return;
+  pending.pending=false;
+  DeliverEvent(pending.rec, coalesceHistory[type] ? &pending.samples : NULL);
+}
 
-  int width = args[0]->Uint32Value();
-  int height = args[1]->Uint32Value();
-  float ratio = width / (float) height;
+// deliver the pending coalesced events of one window, or of all of them
+// when window is negative, oldest first
+void FlushCoalescedEvents(double window=-1) {
+  for(;;) {
+    int next=-1;
+    for(int type=0; type<EVENT_TYPE_COUNT; type++) {
+      const CoalescedEvent &pending=coalesced[type];
+      if(pending.pending && (window<0 || pending.rec.window==window) &&
+         (next<0 || pending.rec.time<coalesced[next].rec.time))
+        next=type;
+    }
+    if(next<0) return;
+    FlushCoalesced(next);
+  }
+}
 
-  float translateX = args[2]->NumberValue();
-  float translateY = args[3]->NumberValue();
-  float translateZ = args[4]->NumberValue();
+void NAN_INLINE(PostEvent(GLFWwindow *window, int type, double a=0, double b=0, double c=0, double d=0)) {
+  InputEvent rec;
+  rec.type=type;
+  rec.window=HandleOf(window);
+  rec.a=a; rec.b=b; rec.c=c; rec.d=d;
+  rec.time=glfwGetTime();
+  rec.reserved=0;
+
+  int policy=coalescePolicy[type];
+  if(policy==COALESCE_NONE) {
+    // e.g. the last mousemove before a mouseup goes first
+    FlushCoalescedEvents(rec.window);
+    DeliverEvent(rec);
+    return;
+  }
 
-  float rotateX = args[5]->NumberValue();
-  float rotateY = args[6]->NumberValue();
-  float rotateZ = args[7]->NumberValue();
+  // samples from different windows are never merged
+  if(coalesced[type].pending && coalesced[type].rec.window!=rec.window)
+    FlushCoalesced(type);
+  if(coalesced[type].pending)
+    eventStats.coalesced[type]++;
+  coalesced[type].Merge(rec, policy, coalesceHistory[type]);
+}
 
-  float angle = args[8]->NumberValue();
+/*
+ * Hand all queued records to JS as one Float64Array. Records queued while
+ * the listeners run, e.g. by a PollEvents of theirs, wait for the next
+ * batch so the array isn't overwritten under them.
+ */
+void FlushEventQueue() {
+  if(!eventQueue.Size() || flushingBatch) return;
+  NanScope();
 
-  glViewport(0, 0, width, height);
-  glClear(GL_COLOR_BUFFER_BIT);
+  if(eventQueue.Size()>batchCapacity) {
+    if(batchData) {
+      NanNew(batchBuffer)->Neuter();
+      batchBuffer.Reset();
+      free(batchData);
+    }
+    batchCapacity=eventQueue.Capacity();
+    batchData=(InputEvent*) malloc(batchCapacity*sizeof(InputEvent));
+    NanAssignPersistent(batchBuffer,
+      ArrayBuffer::New(v8::Isolate::GetCurrent(), batchData, batchCapacity*sizeof(InputEvent)));
+  }
 
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-  glOrtho(-ratio, ratio, -1.f, 1.f, 1.f, -1.f);
-  glMatrixMode(GL_MODELVIEW);
+  size_t count=eventQueue.Drain(batchData, batchCapacity);
+  if(!hasListeners(LISTENER_BATCH)) return;
 
-  glLoadIdentity();
-  glRotatef(angle, rotateX, rotateY, rotateZ);
-  glTranslatef(translateX, translateY, translateZ);
+  for(size_t i=0; i<count; i++)
+    consumed(batchData[i]);
 
-  glBegin(GL_TRIANGLES);
-  glColor3f(1.f, 0.f, 0.f);
-  glVertex3f(-0.6f, -0.4f, 0.f);
-  glColor3f(0.f, 1.f, 0.f);
-  glVertex3f(0.6f, -0.4f, 0.f);
-  glColor3f(0.f, 0.f, 1.f);
-  glVertex3f(0.f, 0.6f, 0.f);
-  glEnd();
+  Handle<Value> argv[1] = {
+    Float64Array::New(NanNew(batchBuffer), 0, count*EVENT_RECORD_SIZE)
+  };
 
-  NanReturnUndefined();
+  flushingBatch=true;
+  CallListeners(LISTENER_BATCH, 1, argv);
+  flushingBatch=false;
 }
 
-NAN_METHOD(testScene) {
-  NanScope();
-  int width = args[0]->Uint32Value();
-  int height = args[1]->Uint32Value();
-  float z = args.Length()>2 ? (float) args[2]->NumberValue() : 0;
-  float ratio = width / (float) height;
-
-  glViewport(0, 0, width, height);
-  glClear(GL_COLOR_BUFFER_BIT);
+/* Deliver coalesced events, then the queued batch */
+void FlushEvents() {
+  FlushCoalescedEvents();
+  FlushEventQueue();
+}
 
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-  glOrtho(-ratio, ratio, -1.f, 1.f, 1.f, -1.f);
-  glMatrixMode(GL_MODELVIEW);
+/* Window callbacks handling */
+void APIENTRY windowPosCB(GLFWwindow *window, int xpos, int ypos) {
+  PostEvent(window, EVENT_WINDOW_POS, xpos, ypos);
+}
 
-  glLoadIdentity();
-  glRotatef((float) glfwGetTime() * 50.f, 0.f, 0.f, 1.f);
+void APIENTRY windowSizeCB(GLFWwindow *window, int w, int h) {
+  //cout<<"resizeCB: "<<w<<" "<<h<<endl;
+  WindowState *state=GetWindowState(window);
+  if(state) {
+    state->width=w;
+    state->height=h;
+  }
+  PostEvent(window, EVENT_RESIZE, w, h);
+}
 
-  glBegin(GL_TRIANGLES);
-  glColor3f(1.f, 0.f, 0.f);
-  glVertex3f(-0.6f+z, -0.4f, 0.f);
-  glColor3f(0.f, 1.f, 0.f);
-  glVertex3f(0.6f+z, -0.4f, 0.f);
-  glColor3f(0.f, 0.f, 1.f);
-  glVertex3f(0.f+z, 0.6f, 0.f);
-  glEnd();
+void APIENTRY windowFramebufferSizeCB(GLFWwindow *window, int w, int h) {
+  PostEvent(window, EVENT_FRAMEBUFFER_RESIZE, w, h);
+}
 
-  NanReturnUndefined();
+void APIENTRY windowCloseCB(GLFWwindow *window) {
+  PostEvent(window, EVENT_QUIT);
 }
 
-NAN_METHOD(WindowHint) {
-  NanScope();
-  int target       = args[0]->Uint32Value();
-  int hint         = args[1]->Uint32Value();
-  glfwWindowHint(target, hint);
-  NanReturnUndefined();
+void APIENTRY windowRefreshCB(GLFWwindow *window) {
+  PostEvent(window, EVENT_REFRESH);
 }
 
-NAN_METHOD(DefaultWindowHints) {
-  NanScope();
-  glfwDefaultWindowHints();
-  NanReturnUndefined();
+void APIENTRY windowIconifyCB(GLFWwindow *window, int iconified) {
+  WindowState *state=GetWindowState(window);
+  if(state)
+    state->throttle.iconified=iconified!=0;
+  PostEvent(window, EVENT_ICONIFIED, iconified);
 }
 
-NAN_METHOD(JoystickPresent) {
-  NanScope();
-  int joy = args[0]->Uint32Value();
-  bool isPresent = glfwJoystickPresent(joy);
-  NanReturnValue(JS_BOOL(isPresent));
+void APIENTRY windowFocusCB(GLFWwindow *window, int focused) {
+  WindowState *state=GetWindowState(window);
+  if(state)
+    state->throttle.focused=focused!=0;
+  PostEvent(window, EVENT_FOCUSED, focused);
 }
 
-std::string intToString(int number) {
-  std::ostringstream buff;
-  buff << number;
-  return buff.str();
+void APIENTRY keyCB(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  WindowState *state=GetWindowState(window);
+  if(state) {
+    if(key>=0 && key<=GLFW_KEY_LAST)
+      state->input.keys[key]=(action!=GLFW_RELEASE);
+    state->input.mods=mods;
+  }
+
+  if(!TwEventKeyGLFW(key,action)) {
+    PostEvent(window, EVENT_KEYUP+action, key, scancode, mods);
+  }
 }
 
-std::string floatToString(float number){
-    std::ostringstream buff;
-    buff<<number;
-    return buff.str();
+void APIENTRY cursorPosCB(GLFWwindow* window, double x, double y) {
+  WindowState *state=GetWindowState(window);
+  if(state) {
+    state->input.cursor[0]=x;
+    state->input.cursor[1]=y;
+
+    // the cursor is captured, positions are virtual and unbounded
+    if(state->relativeMotion) {
+      state->motion[0]+=x-state->motionLast[0];
+      state->motion[1]+=y-state->motionLast[1];
+      state->motionLast[0]=x;
+      state->motionLast[1]=y;
+      PostEvent(window, EVENT_MOUSEMOVE, (int) x, (int) y);
+      return;
+    }
+  }
+
+  if(!TwEventMousePosGLFW(x,y)) {
+    // the size is kept up to date by windowSizeCB
+    if(!state) return;
+    if(x<0 || x>=state->width) return;
+    if(y<0 || y>=state->height) return;
+
+    PostEvent(window, EVENT_MOUSEMOVE, (int) x, (int) y);
+  }
 }
 
-std::string buttonToString(unsigned char c) {
-  int number = (int)c;
-  return intToString(number);
+void APIENTRY cursorEnterCB(GLFWwindow* window, int entered) {
+  PostEvent(window, EVENT_MOUSEENTER, entered);
 }
 
-NAN_METHOD(GetJoystickAxes) {
-  NanScope();
-  int joy = args[0]->Uint32Value();
-  int count;
-  const float *axisValues = glfwGetJoystickAxes(joy, &count);
-  string response = "";
-  for (int i = 0; i < count; i++) {
-    response.append(floatToString(axisValues[i]));
-    response.append(","); //Separator
+void APIENTRY mouseButtonCB(GLFWwindow *window, int button, int action, int mods) {
+  WindowState *state=GetWindowState(window);
+  if(state) {
+    if(button>=0 && button<=GLFW_MOUSE_BUTTON_LAST)
+      state->input.buttons[button]=(action!=GLFW_RELEASE);
+    state->input.mods=mods;
   }
 
-  NanReturnValue(JS_STR(response.c_str()));
+  if(!TwEventMouseButtonGLFW(button,action)) {
+    double x=state ? (int) state->input.cursor[0] : 0;
+    double y=state ? (int) state->input.cursor[1] : 0;
+    PostEvent(window, action ? EVENT_MOUSEDOWN : EVENT_MOUSEUP, button, mods, x, y);
+  }
+}
+
+void APIENTRY scrollCB(GLFWwindow *window, double xoffset, double yoffset) {
+  WindowState *state=GetWindowState(window);
+  if(state) {
+    state->input.scroll[0]+=xoffset;
+    state->input.scroll[1]+=yoffset;
+  }
+
+  if(!TwEventMouseWheelGLFW(yoffset)) {
+    PostEvent(window, EVENT_MOUSEWHEEL, xoffset, yoffset);
+  }
+}
+
+/*
+ * GLFW callbacks are only installed for event kinds somebody consumes, so
+ * unused kinds cost nothing. Call UpdateCallbacks() whenever a consumer is
+ * added or removed.
+ */
+std::vector<GLFWwindow*> windows;
+bool tweakBarInput=false;
+
+void SetTweakBarInput(bool active) {
+  tweakBarInput=active;
+  UpdateCallbacks();
+}
+
+static inline bool wantsGlobal(int type) {
+  // queued records all go to the 'events' batch
+  return hasListeners(queueEvents ? LISTENER_BATCH : type);
+}
+
+void UpdateCallbacks(GLFWwindow *window) {
+  WindowState *state=GetWindowState(window);
+#define wants(type) (wantsGlobal(type) || (state && !state->listeners[type].Empty()))
+  // AntTweakBar and the input state block need every input event
+  bool input=tweakBarInput || (state && !state->inputViews.IsEmpty());
+  bool relative=state && state->relativeMotion;
+  // background throttling tracks focus and iconification
+  bool throttle=state && state->throttle.enabled;
+
+  bool key=input || wants(EVENT_KEYUP) || wants(EVENT_KEYDOWN) || wants(EVENT_KEYPRESS);
+  bool button=input || wants(EVENT_MOUSEDOWN) || wants(EVENT_MOUSEUP);
+  // mouse buttons report the last cursor position
+  bool cursor=input || button || relative || wants(EVENT_MOUSEMOVE);
+  // the cursor bounds check uses the cached size
+  bool size=cursor || wants(EVENT_RESIZE);
+  bool scroll=input || wants(EVENT_MOUSEWHEEL);
+
+  // window callbacks
+  glfwSetWindowPosCallback( window, wants(EVENT_WINDOW_POS) ? windowPosCB : NULL );
+  glfwSetWindowSizeCallback( window, size ? windowSizeCB : NULL );
+  // the cached size went stale while the callback was off
+  if(size && state)
+    glfwGetWindowSize(window, &state->width, &state->height);
+  glfwSetWindowCloseCallback( window, wants(EVENT_QUIT) ? windowCloseCB : NULL );
+  glfwSetWindowRefreshCallback( window, wants(EVENT_REFRESH) ? windowRefreshCB : NULL );
+  glfwSetWindowFocusCallback( window, throttle || wants(EVENT_FOCUSED) ? windowFocusCB : NULL );
+  glfwSetWindowIconifyCallback( window, throttle || wants(EVENT_ICONIFIED) ? windowIconifyCB : NULL );
+  glfwSetFramebufferSizeCallback( window, wants(EVENT_FRAMEBUFFER_RESIZE) ? windowFramebufferSizeCB : NULL );
+
+  // input callbacks
+  glfwSetKeyCallback( window, key ? keyCB : NULL );
+  // TODO glfwSetCharCallback(window, TwEventCharGLFW);
+  glfwSetMouseButtonCallback( window, button ? mouseButtonCB : NULL );
+  glfwSetCursorPosCallback( window, cursor ? cursorPosCB : NULL );
+  glfwSetCursorEnterCallback( window, wants(EVENT_MOUSEENTER) ? cursorEnterCB : NULL );
+  glfwSetScrollCallback( window, scroll ? scrollCB : NULL );
+#undef wants
+}
+
+void UpdateCallbacks() {
+  for(size_t i=0; i<windows.size(); i++)
+    UpdateCallbacks(windows[i]);
+}
+
+// glfwTerminate destroys all remaining windows
+void ReleaseWindowStates() {
+  std::vector<GLFWwindow*> released;
+  released.swap(windows);
+  for(size_t i=0; i<released.size(); i++) {
+    WindowState *state=GetWindowState(released[i]);
+    if(state)
+      windowRegistry.Remove(state->handle);
+    glfwSetWindowUserPointer(released[i], NULL);
+    delete state;
+  }
+}
+
+/* Listeners are called directly by the binding, see index.js for the EventEmitter facade */
+NAN_METHOD(AddEventListener) {
+  NanScope();
+  String::Utf8Value name(args[0]->ToString());
+  int slot=listenerSlot(*name);
+  if(slot<0 || !args[1]->IsFunction())
+    NanReturnValue(JS_BOOL(false));
+
+  Persistent<Function> *fn=new Persistent<Function>();
+  NanAssignPersistent(*fn, args[1].As<Function>());
+  listeners[slot].fns.push_back(fn);
+  UpdateCallbacks();
+  NanReturnValue(JS_BOOL(true));
+}
+
+NAN_METHOD(RemoveEventListener) {
+  NanScope();
+  String::Utf8Value name(args[0]->ToString());
+  int slot=listenerSlot(*name);
+  if(slot<0)
+    NanReturnValue(JS_BOOL(false));
+
+  ListenerList &list=listeners[slot];
+  for(size_t i=list.fns.size(); i-- > 0; ) {
+    if(list.fns[i] && NanNew(*list.fns[i])->StrictEquals(args[1])) {
+      list.fns[i]->Reset();
+      delete list.fns[i];
+      list.fns[i]=NULL;
+      if(!list.dispatching)
+        compactListeners(list);
+      UpdateCallbacks();
+      NanReturnValue(JS_BOOL(true));
+    }
+  }
+  NanReturnValue(JS_BOOL(false));
+}
+
+NAN_METHOD(RemoveAllEventListeners) {
+  NanScope();
+  int first=0, last=LISTENER_BATCH;
+  if(args.Length()>0 && args[0]->IsString()) {
+    String::Utf8Value name(args[0]->ToString());
+    first=last=listenerSlot(*name);
+    if(first<0)
+      NanReturnUndefined();
+  }
+
+  for(int slot=first; slot<=last; slot++) {
+    ListenerList &list=listeners[slot];
+    for(size_t i=0; i<list.fns.size(); i++) {
+      if(list.fns[i]) {
+        list.fns[i]->Reset();
+        delete list.fns[i];
+        list.fns[i]=NULL;
+      }
+    }
+    if(!list.dispatching)
+      compactListeners(list);
+  }
+  UpdateCallbacks();
+  NanReturnUndefined();
+}
+
+/* Listeners of one window, called after the global ones */
+NAN_METHOD(AddWindowEventListener) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  String::Utf8Value name(args[1]->ToString());
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    int type=listenerSlot(*name);
+    if(type<0 || type==LISTENER_BATCH || !args[2]->IsFunction())
+      NanReturnValue(JS_BOOL(false));
+
+    Persistent<Function> *fn=new Persistent<Function>();
+    NanAssignPersistent(*fn, args[2].As<Function>());
+    GetWindowState(window)->listeners[type].fns.push_back(fn);
+    UpdateCallbacks(window);
+    NanReturnValue(JS_BOOL(true));
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(RemoveWindowEventListener) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  String::Utf8Value name(args[1]->ToString());
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    int type=listenerSlot(*name);
+    if(type<0 || type==LISTENER_BATCH)
+      NanReturnValue(JS_BOOL(false));
+
+    ListenerList &list=GetWindowState(window)->listeners[type];
+    for(size_t i=list.fns.size(); i-- > 0; ) {
+      if(list.fns[i] && NanNew(*list.fns[i])->StrictEquals(args[2])) {
+        list.fns[i]->Reset();
+        delete list.fns[i];
+        list.fns[i]=NULL;
+        if(!list.dispatching)
+          compactListeners(list);
+        UpdateCallbacks(window);
+        NanReturnValue(JS_BOOL(true));
+      }
+    }
+    NanReturnValue(JS_BOOL(false));
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(RemoveAllWindowEventListeners) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    int first=0, last=EVENT_TYPE_COUNT-1;
+    if(args.Length()>1 && args[1]->IsString()) {
+      String::Utf8Value name(args[1]->ToString());
+      first=last=listenerSlot(*name);
+      if(first<0 || first==LISTENER_BATCH)
+        NanReturnUndefined();
+    }
+
+    for(int type=first; type<=last; type++) {
+      ListenerList &list=state->listeners[type];
+      list.Release();
+      if(!list.dispatching)
+        compactListeners(list);
+    }
+    UpdateCallbacks(window);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(SetEventQueue) {
+  NanScope();
+  queueEvents=args[0]->BooleanValue();
+  if(!queueEvents)
+    eventQueue.Clear();
+  UpdateCallbacks();
+  NanReturnUndefined();
+}
+
+NAN_METHOD(SetEventQueueLimit) {
+  NanScope();
+  int64_t maxEvents=args[0]->IntegerValue();
+  int policy=args.Length()>1 ? args[1]->Int32Value() : QUEUE_DROP_OLDEST;
+  if(maxEvents<0)
+    return NanThrowError("Invalid queue limit");
+  if(policy<QUEUE_DROP_OLDEST || policy>QUEUE_DROP_NEWEST)
+    return NanThrowError("Invalid overflow policy");
+  eventQueue.SetLimit((size_t) maxEvents, policy, eventStats);
+  NanReturnUndefined();
+}
+
+NAN_METHOD(GetEventQueueStats) {
+  NanScope();
+  Local<Array> dropped=Array::New(v8::Isolate::GetCurrent(),EVENT_TYPE_COUNT);
+  Local<Array> merged=Array::New(v8::Isolate::GetCurrent(),EVENT_TYPE_COUNT);
+  for(int type=0; type<EVENT_TYPE_COUNT; type++) {
+    dropped->Set(type, JS_NUM(eventStats.dropped[type]));
+    merged->Set(type, JS_NUM(eventStats.coalesced[type]));
+  }
+
+  Local<Object> stats=Object::New(v8::Isolate::GetCurrent());
+  stats->Set(JS_STR("size"), JS_NUM(eventQueue.Size()));
+  stats->Set(JS_STR("limit"), JS_NUM(eventQueue.Limit()));
+  stats->Set(JS_STR("highWater"), JS_NUM(eventStats.highWater));
+  stats->Set(JS_STR("dropped"), dropped);
+  stats->Set(JS_STR("coalesced"), merged);
+
+  if(args.Length()>0 && args[0]->BooleanValue())
+    eventStats.Reset();
+  NanReturnValue(stats);
+}
+
+NAN_METHOD(SetEventCoalescing) {
+  NanScope();
+  int type=args[0]->Int32Value();
+  int policy=args[1]->Int32Value();
+  if(!isCoalescible(type))
+    return NanThrowError("Event type can't be coalesced");
+  if(policy<COALESCE_NONE || policy>COALESCE_SUM)
+    return NanThrowError("Invalid coalescing policy");
+  // only wheel offsets are relative, positions and sizes don't add up
+  if(policy==COALESCE_SUM && type!=EVENT_MOUSEWHEEL)
+    return NanThrowError("COALESCE_SUM only applies to mousewheel events");
+
+  FlushCoalesced(type);
+  coalescePolicy[type]=policy;
+  coalesceHistory[type]=args.Length()>2 && args[2]->BooleanValue();
+  NanReturnUndefined();
+}
+
+NAN_METHOD(SetEventObjectReuse) {
+  NanScope();
+  reuseEvents=args[0]->BooleanValue();
+  if(!reuseEvents) {
+    for(int type=0; type<EVENT_TYPE_COUNT; type++)
+      eventObjects[type].Reset();
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(testJoystick) {
+  NanScope();
+
+  int width = args[0]->Uint32Value();
+  int height = args[1]->Uint32Value();
+  float ratio = width / (float) height;
+
+  float translateX = args[2]->NumberValue();
+  float translateY = args[3]->NumberValue();
+  float translateZ = args[4]->NumberValue();
+
+  float rotateX = args[5]->NumberValue();
+  float rotateY = args[6]->NumberValue();
+  float rotateZ = args[7]->NumberValue();
+
+  float angle = args[8]->NumberValue();
+
+  glViewport(0, 0, width, height);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrtho(-ratio, ratio, -1.f, 1.f, 1.f, -1.f);
+  glMatrixMode(GL_MODELVIEW);
+
+  glLoadIdentity();
+  glRotatef(angle, rotateX, rotateY, rotateZ);
+  glTranslatef(translateX, translateY, translateZ);
+
+  glBegin(GL_TRIANGLES);
+  glColor3f(1.f, 0.f, 0.f);
+  glVertex3f(-0.6f, -0.4f, 0.f);
+  glColor3f(0.f, 1.f, 0.f);
+  glVertex3f(0.6f, -0.4f, 0.f);
+  glColor3f(0.f, 0.f, 1.f);
+  glVertex3f(0.f, 0.6f, 0.f);
+  glEnd();
+
+  NanReturnUndefined();
+}
+
+void DrawTestScene(int width, int height, float z) {
+  float ratio = width / (float) height;
+
+  glViewport(0, 0, width, height);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrtho(-ratio, ratio, -1.f, 1.f, 1.f, -1.f);
+  glMatrixMode(GL_MODELVIEW);
+
+  glLoadIdentity();
+  glRotatef((float) glfwGetTime() * 50.f, 0.f, 0.f, 1.f);
+
+  glBegin(GL_TRIANGLES);
+  glColor3f(1.f, 0.f, 0.f);
+  glVertex3f(-0.6f+z, -0.4f, 0.f);
+  glColor3f(0.f, 1.f, 0.f);
+  glVertex3f(0.6f+z, -0.4f, 0.f);
+  glColor3f(0.f, 0.f, 1.f);
+  glVertex3f(0.f+z, 0.6f, 0.f);
+  glEnd();
+}
+
+NAN_METHOD(testScene) {
+  NanScope();
+  int width = args[0]->Uint32Value();
+  int height = args[1]->Uint32Value();
+  float z = args.Length()>2 ? (float) args[2]->NumberValue() : 0;
+  DrawTestScene(width, height, z);
+  NanReturnUndefined();
+}
+
+/*
+ * Window hints are mirrored so pooled windows can be matched with the
+ * configuration they were created with. GLFW_VISIBLE isn't part of it,
+ * pooled windows are created hidden and shown on reuse.
+ */
+typedef std::map<int,int> HintSet;
+HintSet windowHints;
+
+NAN_METHOD(WindowHint) {
+  NanScope();
+  int target       = args[0]->Uint32Value();
+  int hint         = args[1]->Uint32Value();
+  glfwWindowHint(target, hint);
+  windowHints[target]=hint;
+  NanReturnUndefined();
+}
+
+NAN_METHOD(DefaultWindowHints) {
+  NanScope();
+  glfwDefaultWindowHints();
+  windowHints.clear();
+  NanReturnUndefined();
+}
+
+static HintSet poolSignature(const HintSet &hints) {
+  HintSet sig(hints);
+  sig.erase(GLFW_VISIBLE);
+  return sig;
+}
+
+static bool visibleHint() {
+  HintSet::const_iterator it=windowHints.find(GLFW_VISIBLE);
+  return it==windowHints.end() || it->second;
+}
+
+NAN_METHOD(JoystickPresent) {
+  int joy = args[0]->Uint32Value();
+  bool isPresent = glfwJoystickPresent(joy)!=0;
+  NanReturnValue(isPresent);
+}
+
+std::string intToString(int number) {
+  std::ostringstream buff;
+  buff << number;
+  return buff.str();
+}
+
+std::string floatToString(float number){
+    std::ostringstream buff;
+    buff<<number;
+    return buff.str();
+}
+
+std::string buttonToString(unsigned char c) {
+  int number = (int)c;
+  return intToString(number);
+}
+
+NAN_METHOD(GetJoystickAxes) {
+  NanScope();
+  int joy = args[0]->Uint32Value();
+  int count;
+  const float *axisValues = glfwGetJoystickAxes(joy, &count);
+  string response = "";
+  for (int i = 0; i < count; i++) {
+    response.append(floatToString(axisValues[i]));
+    response.append(","); //Separator
+  }
+
+  NanReturnValue(JS_STR(response.c_str()));
+}
+
+NAN_METHOD(GetJoystickButtons) {
+  NanScope();
+  int joy = args[0]->Uint32Value();
+  int count = 0;
+  const unsigned char* response = glfwGetJoystickButtons(joy, &count);
+
+  string strResponse = "";
+  for (int i = 0; i < count; i++) {
+    strResponse.append(buttonToString(response[i]));
+    strResponse.append(",");
+  }
+
+  NanReturnValue(JS_STR(strResponse.c_str()));
+}
+
+NAN_METHOD(GetJoystickName) {
+  NanScope();
+  int joy = args[0]->Uint32Value();
+  const char* response = glfwGetJoystickName(joy);
+  NanReturnValue(JS_STR(response));
+}
+
+/*
+ * Window pool: DestroyWindow hides windowed windows and keeps them, up to
+ * the pool size, and CreateWindow reuses one created with the same hints,
+ * which only costs a resize and a show. A reused context keeps its GL
+ * objects, the common fixed state is reset when it enters the pool.
+ */
+struct PooledWindow {
+  GLFWwindow *window;
+  HintSet hints;
+};
+
+std::vector<PooledWindow> windowPool;
+size_t windowPoolSize=0;
+
+// configurations glewInit has run for, it loads the same entry points again
+std::set<HintSet> glewConfigs;
+
+static void ClearCallbacks(GLFWwindow *window) {
+  glfwSetWindowPosCallback(window, NULL);
+  glfwSetWindowSizeCallback(window, NULL);
+  glfwSetWindowCloseCallback(window, NULL);
+  glfwSetWindowRefreshCallback(window, NULL);
+  glfwSetWindowFocusCallback(window, NULL);
+  glfwSetWindowIconifyCallback(window, NULL);
+  glfwSetFramebufferSizeCallback(window, NULL);
+  glfwSetKeyCallback(window, NULL);
+  glfwSetMouseButtonCallback(window, NULL);
+  glfwSetCursorPosCallback(window, NULL);
+  glfwSetCursorEnterCallback(window, NULL);
+  glfwSetScrollCallback(window, NULL);
+}
+
+// the window's context must be current
+static void ResetContextState() {
+  glDisable(GL_BLEND);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_SCISSOR_TEST);
+  glDisable(GL_STENCIL_TEST);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glDepthMask(GL_TRUE);
+  glClearColor(0, 0, 0, 0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+// run glewInit once per configuration, with the new context current
+static bool InitGlew(const HintSet &sig, string &error) {
+  if(glewConfigs.count(sig))
+    return true;
+
+  GLenum err = glewInit();
+  if (err)
+  {
+    /* Problem: glewInit failed, something is seriously wrong. */
+    error="Can't init GLEW (glew error ";
+    error+=(const char*) glewGetErrorString(err);
+    error+=")";
+    fprintf(stderr, "%s", error.c_str());
+    return false;
+  }
+  fprintf(stdout, "Status: Using GLEW %s\n", glewGetString(GLEW_VERSION));
+  glewConfigs.insert(sig);
+  return true;
+}
+
+static GLFWwindow *TakePooledWindow(const HintSet &sig) {
+  for(size_t i=0; i<windowPool.size(); i++) {
+    if(windowPool[i].hints==sig) {
+      GLFWwindow *window=windowPool[i].window;
+      windowPool.erase(windowPool.begin()+i);
+      return window;
+    }
+  }
+  return NULL;
+}
+
+// glfwTerminate destroys the pooled windows with the others
+void ReleaseWindowPool() {
+  windowPool.clear();
+  glewConfigs.clear();
+}
+
+// SetWindowPoolSize(n), how many destroyed windows are kept for reuse
+NAN_METHOD(SetWindowPoolSize) {
+  NanScope();
+  int size=args[0]->Int32Value();
+  windowPoolSize=size>0 ? size : 0;
+  while(windowPool.size()>windowPoolSize) {
+    glfwDestroyWindow(windowPool.back().window);
+    windowPool.pop_back();
+  }
+  NanReturnUndefined();
+}
+
+// PrewarmWindows(count), create hidden windows with the current hints
+NAN_METHOD(PrewarmWindows) {
+  NanScope();
+  int count=args[0]->Int32Value();
+  if(count<0)
+    count=0;
+  HintSet sig=poolSignature(windowHints);
+  if(windowPoolSize<windowPool.size()+count)
+    windowPoolSize=windowPool.size()+count;
+
+  GLFWwindow *current=glfwGetCurrentContext();
+  glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+  for(int i=0; i<count; i++) {
+    GLFWwindow *window=glfwCreateWindow(64, 64, "", NULL, NULL);
+    if(!window)
+      break;
+    glfwMakeContextCurrent(window);
+    string error;
+    if(!InitGlew(sig, error)) {
+      glfwDestroyWindow(window);
+      break;
+    }
+    PooledWindow pooled;
+    pooled.window=window;
+    pooled.hints=sig;
+    windowPool.push_back(pooled);
+  }
+  glfwWindowHint(GLFW_VISIBLE, visibleHint());
+  glfwMakeContextCurrent(current);
+  NanReturnValue(JS_INT((int) windowPool.size()));
+}
+
+NAN_METHOD(glfw_CreateWindow) {
+  NanScope();
+  int width       = args[0]->Uint32Value();
+  int height      = args[1]->Uint32Value();
+  String::Utf8Value str(args[2]->ToString());
+  int monitor_idx = args[3]->Uint32Value();
+  
+  GLFWwindow* window = NULL;
+  GLFWmonitor **monitors = NULL, *monitor = NULL;
+  int monitor_count;
+  if(args.Length() >= 4 && monitor_idx >= 0){
+    monitors = glfwGetMonitors(&monitor_count);
+    if(monitor_idx >= monitor_count){
+      return NanThrowError("Invalid monitor");
+    }
+    monitor = monitors[monitor_idx];
+  }
+
+  HintSet sig=poolSignature(windowHints);
+  if(!monitor && (window=TakePooledWindow(sig))) {
+    glfwSetWindowTitle(window, *str);
+    glfwSetWindowSize(window, width, height);
+    glfwSetWindowShouldClose(window, GL_FALSE);
+    glfwMakeContextCurrent(window);
+    if(visibleHint())
+      glfwShowWindow(window);
+  }
+  else {
+    window = glfwCreateWindow(width, height, *str, monitor, NULL);
+
+    if(!window) {
+      // can't create window, throw error
+      return NanThrowError("Can't create GLFW window");
+    }
+
+    glfwMakeContextCurrent(window);
+
+    // make sure cursor is always shown
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+
+    string msg;
+    if(!InitGlew(sig, msg))
+      return NanThrowError(msg.c_str());
+  }
+
+  WindowState *state=new WindowState();
+  state->handle=windowRegistry.Add(window);
+  if(!state->handle) {
+    delete state;
+    glfwDestroyWindow(window);
+    return NanThrowError("Too many windows");
+  }
+  state->hints.swap(sig);
+  glfwGetWindowSize(window, &state->width, &state->height);
+  glfwSetWindowUserPointer(window, state);
+  windows.push_back(window);
+
+  // Set callback functions
+  UpdateCallbacks(window);
+
+  NanReturnValue(JS_INT(state->handle));
+}
+
+void ReleaseFences(FrameFences &ff);
+
+NAN_METHOD(DestroyWindow) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    HintSet hints;
+    if(state)
+      hints.swap(state->hints);
+    // unreachable from JS and callbacks before the state goes away
+    windowRegistry.Remove(handle);
+    glfwSetWindowUserPointer(window, NULL);
+    windows.erase(std::remove(windows.begin(), windows.end(), window), windows.end());
+    // a pooled context must not carry our fences to its next user
+    if(state && state->fences.count && !OnRenderThread(state)) {
+      GLFWwindow *current=glfwGetCurrentContext();
+      glfwMakeContextCurrent(window);
+      ReleaseFences(state->fences);
+      glfwMakeContextCurrent(current!=window ? current : NULL);
+    }
+    delete state;
+
+    if(windowPool.size()<windowPoolSize && !glfwGetWindowMonitor(window)) {
+      ClearCallbacks(window);
+      glfwHideWindow(window);
+      glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+
+      GLFWwindow *current=glfwGetCurrentContext();
+      glfwMakeContextCurrent(window);
+      ResetContextState();
+      glfwMakeContextCurrent(current!=window ? current : NULL);
+
+      PooledWindow pooled;
+      pooled.window=window;
+      pooled.hints.swap(hints);
+      windowPool.push_back(pooled);
+    }
+    else
+      glfwDestroyWindow(window);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(SetWindowTitle) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  String::Utf8Value str(args[1]->ToString());
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwSetWindowTitle(window, *str);
+  }
+  NanReturnUndefined();
+}
+
+/*
+ * Copy n values into a caller supplied Int32Array or Float64Array, so
+ * per-frame queries don't allocate. False when out is neither or too short.
+ */
+static bool fillOut(Handle<Value> out, const double *values, int n) {
+  if(!out->IsInt32Array() && !out->IsFloat64Array())
+    return false;
+  Local<Object> array=out->ToObject();
+  if(array->GetIndexedPropertiesExternalArrayDataLength()<n)
+    return false;
+  void *data=array->GetIndexedPropertiesExternalArrayData();
+  for(int i=0; i<n; i++) {
+    if(out->IsInt32Array())
+      ((int32_t*) data)[i]=(int32_t) values[i];
+    else
+      ((double*) data)[i]=values[i];
+  }
+  return true;
+}
+
+static void throwOutError(int n) {
+  string msg="out must be an Int32Array or Float64Array of length "+intToString(n);
+  NanThrowTypeError(msg.c_str());
+}
+
+#define REQ_OUT(out, values, n) \
+  if(!fillOut(out, values, n)) \
+    return throwOutError(n);
+
+// optional out argument of the getters below, filled instead of a new object
+#define HAS_OUT(i) (args.Length()>(i) && !args[i]->IsUndefined())
+
+NAN_METHOD(GetWindowSize) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    int w,h;
+    REQ_WINDOW(handle, window);
+    glfwGetWindowSize(window, &w, &h);
+    if(HAS_OUT(1)) {
+      double values[2]={ (double) w, (double) h };
+      REQ_OUT(args[1], values, 2);
+      NanReturnValue(args[1]);
+    }
+    Local<Array> arr=Array::New(v8::Isolate::GetCurrent(),2);
+    arr->Set(JS_STR("width"),JS_INT(w));
+    arr->Set(JS_STR("height"),JS_INT(h));
+    NanReturnValue(arr);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(SetWindowSize) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwSetWindowSize(window, args[1]->Uint32Value(),args[2]->Uint32Value());
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(SetWindowPos) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwSetWindowPos(window, args[1]->Uint32Value(),args[2]->Uint32Value());
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(GetWindowPos) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    int xpos, ypos;
+    glfwGetWindowPos(window, &xpos, &ypos);
+    if(HAS_OUT(1)) {
+      double values[2]={ (double) xpos, (double) ypos };
+      REQ_OUT(args[1], values, 2);
+      NanReturnValue(args[1]);
+    }
+    Local<Array> arr=Array::New(v8::Isolate::GetCurrent(),2);
+    arr->Set(JS_STR("xpos"),JS_INT(xpos));
+    arr->Set(JS_STR("ypos"),JS_INT(ypos));
+    NanReturnValue(arr);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(GetFramebufferSize) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    if(HAS_OUT(1)) {
+      double values[2]={ (double) width, (double) height };
+      REQ_OUT(args[1], values, 2);
+      NanReturnValue(args[1]);
+    }
+    Local<Array> arr=Array::New(v8::Isolate::GetCurrent(),2);
+    arr->Set(JS_STR("width"),JS_INT(width));
+    arr->Set(JS_STR("height"),JS_INT(height));
+    NanReturnValue(arr);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(IconifyWindow) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwIconifyWindow(window);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(RestoreWindow) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwRestoreWindow(window);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(HideWindow) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwHideWindow(window);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(ShowWindow) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwShowWindow(window);
+  }
+  NanReturnUndefined();
+}
+
+/*
+ * Run a list of window management commands (see WindowCommand) in one call.
+ * out, an Int32Array, gets 1 for each command that ran and 0 for those whose
+ * window was destroyed since they were recorded. Returns how many ran.
+ */
+NAN_METHOD(ExecuteWindowCommands) {
+  NanScope();
+  if(!args[0]->IsInt32Array())
+    return NanThrowTypeError("Commands must be an Int32Array");
+  Local<Object> array=args[0]->ToObject();
+  const int32_t *cmds=(const int32_t*) array->GetIndexedPropertiesExternalArrayData();
+  int length=array->GetIndexedPropertiesExternalArrayDataLength();
+  if(args.Length()>1 && args[1]->IsNumber())
+    length=std::min(length, args[1]->Int32Value());
+
+  Local<Array> titles;
+  if(args.Length()>2 && args[2]->IsArray())
+    titles=Local<Array>::Cast(args[2]);
+
+  // check everything first so a bad list doesn't run halfway
+  int count=0;
+  for(int i=0; i<length; count++) {
+    int argc=WindowCommandArgs(cmds[i]);
+    if(argc<0)
+      return NanThrowError("Invalid window command");
+    if(cmds[i]==WINDOW_CMD_TITLE && i+2<length &&
+       (titles.IsEmpty() || cmds[i+2]<0 || (uint32_t) cmds[i+2]>=titles->Length()))
+      return NanThrowRangeError("Invalid title index");
+    i+=2+argc;
+    if(i>length)
+      return NanThrowError("Truncated window command");
+  }
+
+  int32_t *results=NULL;
+  if(args.Length()>3 && !args[3]->IsUndefined()) {
+    if(!args[3]->IsInt32Array() || args[3]->ToObject()->GetIndexedPropertiesExternalArrayDataLength()<count)
+      return NanThrowTypeError("out must be an Int32Array with one entry per command");
+    results=(int32_t*) args[3]->ToObject()->GetIndexedPropertiesExternalArrayData();
+  }
+
+  int done=0;
+  for(int i=0, n=0; i<length; n++) {
+    const int32_t *cmd=cmds+i;
+    i+=2+WindowCommandArgs(cmd[0]);
+
+    GLFWwindow *window=windowRegistry.Get(cmd[1]);
+    if(results)
+      results[n]=window!=NULL;
+    if(!window)
+      continue;
+
+    switch(cmd[0]) {
+    case WINDOW_CMD_POS:
+      glfwSetWindowPos(window, cmd[2], cmd[3]);
+      break;
+    case WINDOW_CMD_SIZE:
+      glfwSetWindowSize(window, cmd[2], cmd[3]);
+      break;
+    case WINDOW_CMD_TITLE: {
+      String::Utf8Value title(titles->Get(cmd[2])->ToString());
+      glfwSetWindowTitle(window, *title);
+      break;
+    }
+    case WINDOW_CMD_SHOW:
+      glfwShowWindow(window);
+      break;
+    case WINDOW_CMD_HIDE:
+      glfwHideWindow(window);
+      break;
+    case WINDOW_CMD_ICONIFY:
+      glfwIconifyWindow(window);
+      break;
+    case WINDOW_CMD_RESTORE:
+      glfwRestoreWindow(window);
+      break;
+    }
+    done++;
+  }
+  NanReturnValue(JS_INT(done));
+}
+
+NAN_METHOD(WindowShouldClose) {
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    NanReturnValue(glfwWindowShouldClose(window));
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(SetWindowShouldClose) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  int value=args[1]->Uint32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwSetWindowShouldClose(window, value);
+  }
+  NanReturnUndefined();
+}
+
+/*
+ * Everything per-frame layout code asks about a window in one call, see
+ * WindowStateField for the layout of out. Registered as GetWindowState.
+ */
+NAN_METHOD(QueryWindowState) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    int w, h, x, y, fbw, fbh;
+    double cx, cy;
+    glfwGetWindowSize(window, &w, &h);
+    glfwGetWindowPos(window, &x, &y);
+    glfwGetFramebufferSize(window, &fbw, &fbh);
+    glfwGetCursorPos(window, &cx, &cy);
+
+    double values[WINDOW_STATE_SIZE];
+    values[WINDOW_STATE_WIDTH]=w;
+    values[WINDOW_STATE_HEIGHT]=h;
+    values[WINDOW_STATE_X]=x;
+    values[WINDOW_STATE_Y]=y;
+    values[WINDOW_STATE_FB_WIDTH]=fbw;
+    values[WINDOW_STATE_FB_HEIGHT]=fbh;
+    values[WINDOW_STATE_CURSOR_X]=cx;
+    values[WINDOW_STATE_CURSOR_Y]=cy;
+    values[WINDOW_STATE_FOCUSED]=glfwGetWindowAttrib(window, GLFW_FOCUSED);
+    values[WINDOW_STATE_ICONIFIED]=glfwGetWindowAttrib(window, GLFW_ICONIFIED);
+    values[WINDOW_STATE_VISIBLE]=glfwGetWindowAttrib(window, GLFW_VISIBLE);
+    values[WINDOW_STATE_CONTEXT_MAJOR]=glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MAJOR);
+    values[WINDOW_STATE_CONTEXT_MINOR]=glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MINOR);
+    values[WINDOW_STATE_CONTEXT_REVISION]=glfwGetWindowAttrib(window, GLFW_CONTEXT_REVISION);
+    REQ_OUT(args[1], values, WINDOW_STATE_SIZE);
+    NanReturnValue(args[1]);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(GetWindowAttrib) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  int attrib=args[1]->Uint32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    NanReturnValue(JS_INT(glfwGetWindowAttrib(window, attrib)));
+  }
+  NanReturnUndefined();
+}
+
+/* Input action maps */
+void EvaluateActions(GLFWwindow *window, ActionMap &map) {
+  float held[MAX_ACTIONS];
+  memset(held, 0, sizeof(held));
+
+  // joystick state is fetched at most once per joystick
+  const float *axes[GLFW_JOYSTICK_LAST+1];
+  const unsigned char *buttons[GLFW_JOYSTICK_LAST+1];
+  int axisCount[GLFW_JOYSTICK_LAST+1], buttonCount[GLFW_JOYSTICK_LAST+1];
+  bool fetched[GLFW_JOYSTICK_LAST+1];
+  memset(fetched, 0, sizeof(fetched));
+
+  for(size_t i=0; i<map.bindings.size(); i++) {
+    const ActionBinding &b=map.bindings[i];
+    float v=0;
+
+    if(b.source==ACTION_KEY)
+      v=(glfwGetKey(window, b.code)==GLFW_PRESS);
+    else if(b.source==ACTION_MOUSE_BUTTON)
+      v=(glfwGetMouseButton(window, b.code)==GLFW_PRESS);
+    else {
+      int joy=b.joystick;
+      if(!fetched[joy]) {
+        axes[joy]=glfwGetJoystickAxes(joy, &axisCount[joy]);
+        buttons[joy]=glfwGetJoystickButtons(joy, &buttonCount[joy]);
+        if(!axes[joy]) axisCount[joy]=0;
+        if(!buttons[joy]) buttonCount[joy]=0;
+        fetched[joy]=true;
+      }
+
+      if(b.source==ACTION_JOYSTICK_BUTTON) {
+        if(b.code<buttonCount[joy])
+          v=(buttons[joy][b.code]==GLFW_PRESS);
+      }
+      else if(b.code<axisCount[joy]) {
+        float axis=axes[joy][b.code];
+        if(b.threshold>=0)
+          v = axis>b.threshold ? axis : 0;
+        else
+          v = axis<b.threshold ? -axis : 0;
+      }
+    }
+
+    if(v>held[b.action])
+      held[b.action]=v;
+  }
+
+  for(size_t i=0; i<map.names.size(); i++) {
+    ActionState &state=map.state[i];
+    bool was=state.value>0, on=held[i]>0;
+    state.pressed=(on && !was);
+    state.released=(!on && was);
+    state.value=held[i];
+  }
+}
+
+void UpdateActions() {
+  for(size_t i=0; i<windows.size(); i++) {
+    WindowState *state=GetWindowState(windows[i]);
+    if(state && !state->actions.bindings.empty())
+      EvaluateActions(windows[i], state->actions);
+  }
+}
+
+/* Everything that follows glfwPollEvents/glfwWaitEvents */
+void ProcessEvents() {
+  UpdateActions();
+  FlushEvents();
+}
+
+NAN_METHOD(PollEvents) {
+  NanScope();
+  glfwPollEvents();
+  ProcessEvents();
+  NanReturnUndefined();
+}
+
+NAN_METHOD(WaitEvents) {
+  NanScope();
+  glfwWaitEvents();
+  ProcessEvents();
+  NanReturnUndefined();
+}
+
+/*
+ * Event watcher: instead of blocking in glfwWaitEvents, let libuv wake us up
+ * when the windowing system has something for us and poll then. Timers,
+ * sockets and IPC keep running and idle windows cost no CPU.
+ *
+ * On X11 the display connection is watched with uv_poll. Xlib may already
+ * have read events into its own queue during other calls (swaps, queries),
+ * these don't make the fd readable, so a slow timer polls as well. Other
+ * platforms only have the timer.
+ */
+uv_poll_t *eventPoll=NULL;
+uv_timer_t eventTimer;
+bool eventTimerInit=false;
+
+void PumpEvents() {
+  NanScope();
+  TryCatch tc;
+  glfwPollEvents();
+  ProcessEvents();
+  if(tc.HasCaught())
+    FatalException(tc);
+}
+
+void eventPollCB(uv_poll_t *handle, int status, int events) {
+  PumpEvents();
+}
+
+void eventTimerCB(uv_timer_t *handle) {
+  PumpEvents();
+}
+
+void eventPollCloseCB(uv_handle_t *handle) {
+  delete (uv_poll_t*) handle;
+}
+
+void StopWatcher() {
+  if(eventPoll) {
+    uv_poll_stop(eventPoll);
+    uv_close((uv_handle_t*) eventPoll, eventPollCloseCB);
+    eventPoll=NULL;
+  }
+  if(eventTimerInit)
+    uv_timer_stop(&eventTimer);
+}
+
+// StartEventWatcher([intervalMs]), the interval of the fallback timer
+NAN_METHOD(StartEventWatcher) {
+  NanScope();
+  StopWatcher();
+
+#if defined(GLFW_EXPOSE_NATIVE_X11)
+  double interval=args.Length()>0 ? args[0]->NumberValue() : 100;
+  Display *display=glfwGetX11Display();
+  if(!display)
+    return NanThrowError("GLFW is not initialized");
+
+  eventPoll=new uv_poll_t;
+  uv_poll_init(uv_default_loop(), eventPoll, ConnectionNumber(display));
+  uv_poll_start(eventPoll, UV_READABLE, eventPollCB);
+#else
+  double interval=args.Length()>0 ? args[0]->NumberValue() : 16;
+#endif
+
+  if(!eventTimerInit) {
+    uv_timer_init(uv_default_loop(), &eventTimer);
+    eventTimerInit=true;
+  }
+  uint64_t ms=interval>1 ? (uint64_t) interval : 1;
+  uv_timer_start(&eventTimer, eventTimerCB, ms, ms);
+
+  // drain what arrived before the watcher was started
+  glfwPollEvents();
+  ProcessEvents();
+  NanReturnUndefined();
+}
+
+NAN_METHOD(StopEventWatcher) {
+  NanScope();
+  StopWatcher();
+  NanReturnUndefined();
+}
+
+/* Input handling */
+NAN_METHOD(GetKey) {
+  int handle=args[0]->Int32Value();
+  int key=args[1]->Uint32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    NanReturnValue(glfwGetKey(window, key));
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(GetMouseButton) {
+  int handle=args[0]->Int32Value();
+  int button=args[1]->Uint32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    NanReturnValue(glfwGetMouseButton(window, button));
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(GetCursorPos) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    double x,y;
+    glfwGetCursorPos(window, &x, &y);
+    if(HAS_OUT(1)) {
+      double values[2]={ x, y };
+      REQ_OUT(args[1], values, 2);
+      NanReturnValue(args[1]);
+    }
+    Local<Array> arr=Array::New(v8::Isolate::GetCurrent(),2);
+    arr->Set(JS_STR("x"),JS_INT(x));
+    arr->Set(JS_STR("y"),JS_INT(y));
+    NanReturnValue(arr);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(SetCursorPos) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  int x=args[1]->NumberValue();
+  int y=args[2]->NumberValue();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    glfwSetCursorPos(window, x, y);
+  }
+  NanReturnUndefined();
+}
+
+/*
+ * Relative motion mode for mouse-look: the cursor is disabled and motion is
+ * accumulated natively, read it once per frame with GetCursorDelta.
+ */
+NAN_METHOD(SetRelativeMotion) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  bool enable=args[1]->BooleanValue();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state || state->relativeMotion==enable)
+      NanReturnUndefined();
+
+    glfwSetInputMode(window, GLFW_CURSOR, enable ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+    glfwGetCursorPos(window, &state->motionLast[0], &state->motionLast[1]);
+    state->motion[0]=state->motion[1]=0;
+    state->relativeMotion=enable;
+    UpdateCallbacks(window);
+  }
+  NanReturnUndefined();
+}
+
+/* Float64Array [dx, dy] of the motion since the previous call, always the same array */
+NAN_METHOD(GetCursorDelta) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    state->motionRead[0]=state->motion[0];
+    state->motionRead[1]=state->motion[1];
+    state->motion[0]=state->motion[1]=0;
+
+    if(state->motionView.IsEmpty()) {
+      Local<ArrayBuffer> buffer=ArrayBuffer::New(v8::Isolate::GetCurrent(), state->motionRead, sizeof(state->motionRead));
+      NanAssignPersistent(state->motionView, Float64Array::New(buffer, 0, 2));
+    }
+    NanReturnValue(NanNew(state->motionView));
+  }
+  NanReturnUndefined();
+}
+
+/* Typed array views on the live input state of a window, see window.h */
+NAN_METHOD(GetInputState) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    if(state->inputViews.IsEmpty()) {
+      InputState *input=&state->input;
+      Local<ArrayBuffer> buffer=ArrayBuffer::New(v8::Isolate::GetCurrent(), input, sizeof(InputState));
+      Local<Object> views=Object::New(v8::Isolate::GetCurrent());
+      views->Set(JS_STR("buffer"), buffer);
+      views->Set(JS_STR("cursor"), Float64Array::New(buffer, offsetof(InputState, cursor), 2));
+      views->Set(JS_STR("scroll"), Float64Array::New(buffer, offsetof(InputState, scroll), 2));
+      views->Set(JS_STR("mods"), Int32Array::New(buffer, offsetof(InputState, mods), 1));
+      views->Set(JS_STR("buttons"), Uint8Array::New(buffer, offsetof(InputState, buttons), GLFW_MOUSE_BUTTON_LAST+1));
+      views->Set(JS_STR("keys"), Uint8Array::New(buffer, offsetof(InputState, keys), GLFW_KEY_LAST+1));
+      NanAssignPersistent(state->inputBuffer, buffer);
+      NanAssignPersistent(state->inputViews, views);
+      UpdateCallbacks(window);
+    }
+    NanReturnValue(NanNew(state->inputViews));
+  }
+  NanReturnUndefined();
 }
 
-NAN_METHOD(GetJoystickButtons) {
+/* Bind a named action to an input, returns the action index in GetActionState */
+NAN_METHOD(BindAction) {
   NanScope();
-  int joy = args[0]->Uint32Value();
-  int count = 0;
-  const unsigned char* response = glfwGetJoystickButtons(joy, &count);
+  int handle=args[0]->Int32Value();
+  String::Utf8Value name(args[1]->ToString());
+  int source=args[2]->Int32Value();
+  int code=args[3]->Int32Value();
+  int joystick=args.Length()>4 ? args[4]->Int32Value() : 0;
+  double threshold=args.Length()>5 ? args[5]->NumberValue() : 0.5;
 
-  string strResponse = "";
-  for (int i = 0; i < count; i++) {
-    strResponse.append(buttonToString(response[i]));
-    strResponse.append(",");
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    if(source<ACTION_KEY || source>ACTION_JOYSTICK_AXIS)
+      return NanThrowError("Invalid action source");
+    if(source==ACTION_KEY && (code<0 || code>GLFW_KEY_LAST))
+      return NanThrowError("Invalid key");
+    if(source==ACTION_MOUSE_BUTTON && (code<0 || code>GLFW_MOUSE_BUTTON_LAST))
+      return NanThrowError("Invalid mouse button");
+    if(code<0 || joystick<0 || joystick>GLFW_JOYSTICK_LAST)
+      return NanThrowError("Invalid joystick input");
+
+    int action=state->actions.Find(*name);
+    if(action<0)
+      return NanThrowError("Too many actions");
+
+    ActionBinding b;
+    b.action=action;
+    b.source=source;
+    b.code=code;
+    b.joystick=joystick;
+    b.threshold=(float) threshold;
+    state->actions.bindings.push_back(b);
+    NanReturnValue(JS_INT(action));
   }
-
-  NanReturnValue(JS_STR(strResponse.c_str()));
+  NanReturnUndefined();
 }
 
-NAN_METHOD(GetJoystickName) {
+NAN_METHOD(ClearActions) {
   NanScope();
-  int joy = args[0]->Uint32Value();
-  const char* response = glfwGetJoystickName(joy);
-  NanReturnValue(JS_STR(response));
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(state)
+      state->actions.Clear();
+  }
+  NanReturnUndefined();
 }
 
-NAN_METHOD(glfw_CreateWindow) {
+/* Float32Array of [value, pressed, released] per action, updated by PollEvents */
+NAN_METHOD(GetActionState) {
   NanScope();
-  int width       = args[0]->Uint32Value();
-  int height      = args[1]->Uint32Value();
-  String::Utf8Value str(args[2]->ToString());
-  int monitor_idx = args[3]->Uint32Value();
-  
-  GLFWwindow* window = NULL;
-  GLFWmonitor **monitors = NULL, *monitor = NULL;
-  int monitor_count;
-  if(args.Length() >= 4 && monitor_idx >= 0){
-    monitors = glfwGetMonitors(&monitor_count);
-    if(monitor_idx >= monitor_count){
-      return NanThrowError("Invalid monitor");
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    if(state->actionView.IsEmpty()) {
+      Local<ArrayBuffer> buffer=ArrayBuffer::New(v8::Isolate::GetCurrent(), state->actions.state, sizeof(state->actions.state));
+      NanAssignPersistent(state->actionView, Float32Array::New(buffer, 0, MAX_ACTIONS*ACTION_STATE_SIZE));
     }
-    monitor = monitors[monitor_idx];
+    NanReturnValue(NanNew(state->actionView));
   }
+  NanReturnUndefined();
+}
 
-  if(!windowCreated) {
-    window = glfwCreateWindow(width, height, *str, monitor, NULL);
-
-    if(!window) {
-      // can't create window, throw error
-      return NanThrowError("Can't create GLFW window");
-    }
-
+/* @Module Context handling */
+NAN_METHOD(MakeContextCurrent) {
+  NanScope();
+  int handle=args[0]->Int32Value();
+  if(handle) {
+    REQ_WINDOW(handle, window);
+    if(OnRenderThread(GetWindowState(window)))
+      return NanThrowError("The context is owned by a render thread");
     glfwMakeContextCurrent(window);
+  }
+  NanReturnUndefined();
+}
 
-    // make sure cursor is always shown
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-
-    GLenum err = glewInit();
-    if (err)
-    {
-      /* Problem: glewInit failed, something is seriously wrong. */
-      string msg="Can't init GLEW (glew error ";
-      msg+=(const char*) glewGetErrorString(err);
-      msg+=")";
+NAN_METHOD(GetCurrentContext) {
+  NanScope();
+  GLFWwindow* window=glfwGetCurrentContext();
+  NanReturnValue(JS_INT(HandleOf(window)));
+}
 
-      fprintf(stderr, "%s", msg.c_str());
-      return NanThrowError(msg.c_str());
-    }
-    fprintf(stdout, "Status: Using GLEW %s\n", glewGetString(GLEW_VERSION));
+/* Input to swap latency, sampled once per swap following new input */
+void TrackLatency(GLFWwindow *window) {
+  WindowState *state=GetWindowState(window);
+  if(state && state->newestInput>=0) {
+    state->latency.Add(glfwGetTime()-state->newestInput);
+    state->newestInput=-1;
   }
-  else
-    glfwSetWindowSize(window, width,height);
+}
 
-  // Set callback functions
-  // glfw_events=Persistent<Object>::New(args.This()->Get(JS_STR("events"))->ToObject());
-  //NanInitPersistent(Object,_events,args.This()->Get(JS_STR("events"))->ToObject());
-  NanAssignPersistent(glfw_events, args.This()->Get(JS_STR("events"))->ToObject());
+/*
+ * Frame pacing, see pacing.h. The wait before a paced swap sleeps until
+ * shortly before the deadline and spins on glfwGetTime for the rest, OS
+ * sleeps are too coarse to hit it on their own.
+ */
+static void SleepSeconds(double seconds) {
+#ifdef _WIN32
+  Sleep((DWORD) (seconds*1000));
+#else
+  usleep((useconds_t) (seconds*1e6));
+#endif
+}
 
-  // window callbacks
-  glfwSetWindowPosCallback( window, windowPosCB );
-  glfwSetWindowSizeCallback( window, windowSizeCB );
-  glfwSetWindowCloseCallback( window, windowCloseCB );
-  glfwSetWindowRefreshCallback( window, windowRefreshCB );
-  glfwSetWindowFocusCallback( window, windowFocusCB );
-  glfwSetWindowIconifyCallback( window, windowIconifyCB );
-  glfwSetFramebufferSizeCallback( window, windowFramebufferSizeCB );
+void WaitForDeadline(FramePacer &pacer) {
+  double remaining=pacer.Remaining(glfwGetTime());
+  if(remaining>pacer.Spin())
+    SleepSeconds(remaining-pacer.Spin());
+  while(pacer.Remaining(glfwGetTime())>0)
+    ;
+}
 
-  // input callbacks
-  glfwSetKeyCallback( window, keyCB);
-  // TODO glfwSetCharCallback(window, TwEventCharGLFW);
-  glfwSetMouseButtonCallback( window, mouseButtonCB );
-  glfwSetCursorPosCallback( window, cursorPosCB );
-  glfwSetCursorEnterCallback( window, cursorEnterCB );
-  glfwSetScrollCallback( window, scrollCB );
+// wait for the deadline of a paced window, before swapping
+void PaceFrame(WindowState *state) {
+  if(!state || !state->pacer.Active()) return;
+  WaitForDeadline(state->pacer);
+  state->pacer.FrameDone(glfwGetTime());
+}
 
-  NanReturnValue(JS_NUM((uint64_t) window));
+void ConfigurePacing(WindowState *state, double fps, Handle<Value> opts) {
+  double minFps=0, spin=2;
+  bool adaptive=false;
+  if(opts->IsObject()) {
+    Local<Object> options=opts->ToObject();
+    Local<Value> val=options->Get(JS_STR("minFps"));
+    if(val->IsNumber()) minFps=val->NumberValue();
+    val=options->Get(JS_STR("adaptive"));
+    if(!val->IsUndefined()) adaptive=val->BooleanValue();
+    val=options->Get(JS_STR("spin"));
+    if(val->IsNumber()) spin=val->NumberValue();
+  }
+  state->pacer.Configure(fps, minFps, adaptive, spin/1000);
 }
 
-NAN_METHOD(DestroyWindow) {
+/*
+ * SetFramePacing(window, fps[, options]) caps SwapBuffers and RunLoop at fps,
+ * 0 turns pacing off.
+ *   options.minFps    lowest rate the adaptive mode may fall back to
+ *   options.adaptive  lower the rate while frames overrun, raise it back after
+ *   options.spin      milliseconds spun before each deadline (2)
+ */
+NAN_METHOD(SetFramePacing) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
+  double fps=args[1]->NumberValue();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwDestroyWindow(window);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(state)
+      ConfigurePacing(state, fps, args[2]);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(SetWindowTitle) {
+/* Deadline statistics, jitter in milliseconds */
+NAN_METHOD(GetFramePacingStats) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  String::Utf8Value str(args[1]->ToString());
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwSetWindowTitle(window, *str);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    FramePacer &pacer=state->pacer;
+    Local<Object> stats=Object::New(v8::Isolate::GetCurrent());
+    stats->Set(JS_STR("target"), JS_NUM(pacer.Target()));
+    stats->Set(JS_STR("rate"), JS_NUM(pacer.Rate()));
+    stats->Set(JS_STR("frames"), JS_NUM(pacer.Frames()));
+    stats->Set(JS_STR("missed"), JS_NUM(pacer.Missed()));
+    stats->Set(JS_STR("jitterP50"), JS_NUM(pacer.Jitter().Percentile(0.5)*1000));
+    stats->Set(JS_STR("jitterP99"), JS_NUM(pacer.Jitter().Percentile(0.99)*1000));
+    stats->Set(JS_STR("jitterMax"), JS_NUM(pacer.Jitter().Percentile(1)*1000));
+
+    if(args.Length()>1 && args[1]->BooleanValue())
+      pacer.ResetStats();
+    NanReturnValue(stats);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(GetWindowSize) {
-  NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  if(handle) {
-    int w,h;
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwGetWindowSize(window, &w, &h);
-    Local<Array> arr=Array::New(v8::Isolate::GetCurrent(),2);
-    arr->Set(JS_STR("width"),JS_INT(w));
-    arr->Set(JS_STR("height"),JS_INT(h));
-    NanReturnValue(arr);
+/*
+ * Frames in flight: a fence follows each swap and once more than max frames
+ * are queued we wait for the oldest one, so the driver can't run ahead and
+ * add latency. The fences belong to the window's context.
+ */
+void ReleaseFences(FrameFences &ff) {
+  for(; ff.count>0; ff.count--) {
+    glDeleteSync(ff.fences[ff.head]);
+    ff.head=(ff.head+1) % (MAX_FRAMES_IN_FLIGHT+1);
   }
-  NanReturnUndefined();
+  ff.head=0;
 }
 
-NAN_METHOD(SetWindowSize) {
+void LimitFramesInFlight(GLFWwindow *window, WindowState *state) {
+  if(!state || !state->fences.max) return;
+  FrameFences &ff=state->fences;
+
+  GLFWwindow *current=glfwGetCurrentContext();
+  if(current!=window)
+    glfwMakeContextCurrent(window);
+
+  ff.fences[(ff.head+ff.count) % (MAX_FRAMES_IN_FLIGHT+1)]=glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  ff.count++;
+
+  while(ff.count>ff.max) {
+    GLsync oldest=ff.fences[ff.head];
+    double start=glfwGetTime();
+    GLenum ret;
+    do {
+      ret=glClientWaitSync(oldest, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+    } while(ret==GL_TIMEOUT_EXPIRED);
+    ff.waits.Add(glfwGetTime()-start);
+    glDeleteSync(oldest);
+    ff.head=(ff.head+1) % (MAX_FRAMES_IN_FLIGHT+1);
+    ff.count--;
+  }
+
+  if(current!=window)
+    glfwMakeContextCurrent(current);
+}
+
+// SetMaxFramesInFlight(window, n), 0 lets the driver queue as it likes
+NAN_METHOD(SetMaxFramesInFlight) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
+  int max=args[1]->Int32Value();
+  if(max<0 || max>MAX_FRAMES_IN_FLIGHT)
+    return NanThrowRangeError("Frames in flight must be between 0 and 8");
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwSetWindowSize(window, args[1]->Uint32Value(),args[2]->Uint32Value());
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+    if(OnRenderThread(state))
+      return NanThrowError("The context is owned by a render thread");
+
+    GLFWwindow *current=glfwGetCurrentContext();
+    if(current!=window)
+      glfwMakeContextCurrent(window);
+    bool supported=GLEW_ARB_sync || GLEW_VERSION_3_2;
+    if(supported)
+      ReleaseFences(state->fences);
+    if(current!=window)
+      glfwMakeContextCurrent(current);
+
+    if(!supported)
+      return NanThrowError("Fence syncs (ARB_sync) are not supported");
+    state->fences.max=max;
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(SetWindowPos) {
+/* Time spent waiting for the GPU to catch up, in milliseconds */
+NAN_METHOD(GetFramesInFlightStats) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwSetWindowPos(window, args[1]->Uint32Value(),args[2]->Uint32Value());
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    FrameFences &ff=state->fences;
+    Local<Object> stats=Object::New(v8::Isolate::GetCurrent());
+    stats->Set(JS_STR("limit"), JS_INT(ff.max));
+    stats->Set(JS_STR("inFlight"), JS_INT(ff.count));
+    stats->Set(JS_STR("waits"), JS_NUM(ff.waits.Total()));
+    stats->Set(JS_STR("p50"), JS_NUM(ff.waits.Percentile(0.5)*1000));
+    stats->Set(JS_STR("p99"), JS_NUM(ff.waits.Percentile(0.99)*1000));
+    stats->Set(JS_STR("max"), JS_NUM(ff.waits.Percentile(1)*1000));
+
+    if(args.Length()>1 && args[1]->BooleanValue())
+      ff.waits.Reset();
+    NanReturnValue(stats);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(GetWindowPos) {
+/*
+ * Background throttling, see BackgroundThrottle in window.h. SwapBuffers
+ * sleeps (at most 100ms at a time) until a throttled window may show its
+ * next frame and drops the swap when it may not, RunLoop and animation
+ * frames wait in libuv instead. ShouldRender lets JS skip the rendering too.
+ */
+double ThrottleDelay(GLFWwindow *window, WindowState *state) {
+  if(!state || !state->throttle.enabled) return 0;
+  return state->throttle.Delay(glfwGetWindowAttrib(window, GLFW_VISIBLE)!=0, glfwGetTime());
+}
+
+// SetBackgroundThrottle(window, { iconified, hidden, unfocused }), false disables it
+NAN_METHOD(SetBackgroundThrottle) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    int xpos, ypos;
-    glfwGetWindowPos(window, &xpos, &ypos);
-    Local<Array> arr=Array::New(v8::Isolate::GetCurrent(),2);
-    arr->Set(JS_STR("xpos"),JS_INT(xpos));
-    arr->Set(JS_STR("ypos"),JS_INT(ypos));
-    NanReturnValue(arr);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    BackgroundThrottle &throttle=state->throttle;
+    throttle=BackgroundThrottle();
+    throttle.enabled=args[1]->BooleanValue();
+    if(args[1]->IsObject()) {
+      Local<Object> rates=args[1]->ToObject();
+      Local<Value> val=rates->Get(JS_STR("iconified"));
+      if(val->IsNumber()) throttle.iconifiedRate=val->NumberValue();
+      val=rates->Get(JS_STR("hidden"));
+      if(val->IsNumber()) throttle.hiddenRate=val->NumberValue();
+      val=rates->Get(JS_STR("unfocused"));
+      if(val->IsNumber()) throttle.unfocusedRate=val->NumberValue();
+    }
+    throttle.iconified=glfwGetWindowAttrib(window, GLFW_ICONIFIED)!=0;
+    throttle.focused=glfwGetWindowAttrib(window, GLFW_FOCUSED)!=0;
+    UpdateCallbacks(window);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(GetFramebufferSize) {
+// whether a frame rendered now would be shown under the throttle policy
+NAN_METHOD(ShouldRender) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-    Local<Array> arr=Array::New(v8::Isolate::GetCurrent(),2);
-    arr->Set(JS_STR("width"),JS_INT(width));
-    arr->Set(JS_STR("height"),JS_INT(height));
-    NanReturnValue(arr);
+    REQ_WINDOW(handle, window);
+    NanReturnValue(JS_BOOL(ThrottleDelay(window, GetWindowState(window))==0));
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(IconifyWindow) {
+/*
+ * The interval a context runs with is cached in appliedInterval so contexts
+ * are only made current when it has to change, swapInterval keeps what was
+ * asked for with SwapInterval.
+ */
+static void applySwapInterval(GLFWwindow *window, WindowState *state, int interval) {
+  if(state->appliedInterval==interval) return;
+  if(glfwGetCurrentContext()!=window)
+    glfwMakeContextCurrent(window);
+  glfwSwapInterval(interval);
+  state->appliedInterval=interval;
+}
+
+// undo what SwapBuffersBatch applied before a plain swap
+static void restoreSwapInterval(GLFWwindow *window, WindowState *state) {
+  if(!state || state->swapInterval<0 || state->appliedInterval==state->swapInterval)
+    return;
+  GLFWwindow *current=glfwGetCurrentContext();
+  applySwapInterval(window, state, state->swapInterval);
+  if(current!=window)
+    glfwMakeContextCurrent(current);
+}
+
+NAN_METHOD(SwapBuffers) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwIconifyWindow(window);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(OnRenderThread(state))
+      return NanThrowError("The window is swapped by its render thread");
+    if(state && state->throttle.enabled) {
+      double delay=ThrottleDelay(window, state);
+      if(delay<0 || delay>0.1) {
+        SleepSeconds(0.1);
+        NanReturnUndefined();
+      }
+      if(delay>0)
+        SleepSeconds(delay);
+      state->throttle.lastFrame=glfwGetTime();
+    }
+    PaceFrame(state);
+    restoreSwapInterval(window, state);
+    glfwSwapBuffers(window);
+    LimitFramesInFlight(window, state);
+    TrackLatency(window);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(RestoreWindow) {
+/*
+ * SwapBuffersBatch(windows[, interval]) presents several windows with a
+ * single vsync wait: every window but the last swaps with interval 0 and the
+ * last one with interval (by default the largest SwapInterval of the batch,
+ * or 1). Only windows whose interval was set with SwapInterval take part,
+ * there is no way back to a driver default we don't know, the others swap
+ * with their own interval. Windows are paced before the first swap.
+ * Throttled windows are skipped.
+ */
+NAN_METHOD(SwapBuffersBatch) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwRestoreWindow(window);
+  if(!args[0]->IsArray())
+    return NanThrowTypeError("Expected an array of windows");
+  Local<Array> list=Local<Array>::Cast(args[0]);
+  uint32_t count=list->Length();
+  if(!count)
+    NanReturnUndefined();
+
+  std::vector<GLFWwindow*> batch;
+  batch.reserve(count);
+  for(uint32_t i=0; i<count; i++) {
+    GLFWwindow* window = windowRegistry.Get(list->Get(i)->Int32Value());
+    WindowState *state=window ? GetWindowState(window) : NULL;
+    if(state && !OnRenderThread(state) && ThrottleDelay(window, state)==0)
+      batch.push_back(window);
+  }
+  if(batch.empty())
+    NanReturnUndefined();
+
+  GLFWwindow *current=glfwGetCurrentContext();
+  GLFWwindow *last=NULL;
+  for(size_t i=0; i<batch.size(); i++) {
+    if(GetWindowState(batch[i])->swapInterval>=0)
+      last=batch[i];
   }
+  int interval=-1;
+  if(args.Length()>1)
+    interval=args[1]->Int32Value();
+  else {
+    for(size_t i=0; i<batch.size(); i++)
+      interval=std::max(interval, GetWindowState(batch[i])->swapInterval);
+  }
+  if(interval<0)
+    interval=1;
+
+  for(size_t i=0; i<batch.size(); i++)
+    PaceFrame(GetWindowState(batch[i]));
+
+  for(size_t i=0; i<batch.size(); i++) {
+    GLFWwindow *window=batch[i];
+    WindowState *state=GetWindowState(window);
+    if(state->swapInterval>=0)
+      applySwapInterval(window, state, window==last ? interval : 0);
+    state->throttle.lastFrame=glfwGetTime();
+    glfwSwapBuffers(window);
+    LimitFramesInFlight(window, state);
+    TrackLatency(window);
+  }
+
+  if(glfwGetCurrentContext()!=current)
+    glfwMakeContextCurrent(current);
   NanReturnUndefined();
 }
 
-NAN_METHOD(HideWindow) {
+/*
+ * Render thread: StartRenderThread(window) hands the window's context to a
+ * native thread, SubmitCommands(window, Float64Array[, length][, onDone])
+ * queues a recorded frame for it (see renderer.h for the commands), onDone
+ * is called on the main thread with the frame number once it executed, and
+ * StopRenderThread(window) finishes the queued frames and gives the context
+ * back to the main thread. Submitting waits while a frame is already queued,
+ * JS stays at most one frame ahead.
+ */
+// SubmitCommands callbacks, run on the main thread once the frame has executed
+struct FrameDone {
+  Persistent<Function> callback;
+  double frame;
+};
+
+void frameDoneTask(void *data) {
+  assert(mainThread.IsMainThread());
+  FrameDone *done=(FrameDone*) data;
+  NanScope();
+  Local<Function> callback=NanNew(done->callback);
+  Local<Value> argv[1] = { JS_NUM(done->frame) };
+  done->callback.Reset();
+  delete done;
+  NanMakeCallback(NanGetCurrentContext()->Global(), callback, 1, argv);
+}
+
+NAN_METHOD(StartRenderThread) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwHideWindow(window);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state || state->renderer)
+      NanReturnUndefined();
+
+    // fences belong to the context, drop them while we still own it
+    if(state->fences.max) {
+      GLFWwindow *current=glfwGetCurrentContext();
+      glfwMakeContextCurrent(window);
+      ReleaseFences(state->fences);
+      glfwMakeContextCurrent(current);
+      state->fences.max=0;
+    }
+    if(glfwGetCurrentContext()==window)
+      glfwMakeContextCurrent(NULL);
+
+    state->renderer=new RenderThread(window, frameDoneTask);
+    state->renderer->Start();
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(ShowWindow) {
+NAN_METHOD(SubmitCommands) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
+  if(!args[1]->IsFloat64Array())
+    return NanThrowTypeError("Commands must be a Float64Array");
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwShowWindow(window);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!OnRenderThread(state))
+      return NanThrowError("The window has no render thread");
+
+    Local<Object> array=args[1]->ToObject();
+    const double *cmds=(const double*) array->GetIndexedPropertiesExternalArrayData();
+    int length=array->GetIndexedPropertiesExternalArrayDataLength();
+    if(args.Length()>2 && args[2]->IsNumber()) {
+      if(args[2]->Int32Value()<0)
+        return NanThrowRangeError("Length must not be negative");
+      length=std::min(length, args[2]->Int32Value());
+    }
+
+    // the thread can't report errors, check everything here
+    for(int i=0; i<length; ) {
+      int argc=RenderCommandArgs((int) cmds[i]);
+      if(argc<0)
+        return NanThrowError("Invalid render command");
+      i+=1+argc;
+      if(i>length)
+        return NanThrowError("Truncated render command");
+    }
+
+    FrameDone *done=NULL;
+    Local<Value> callback=args[args.Length()-1];
+    if(args.Length()>2 && callback->IsFunction()) {
+      done=new FrameDone();
+      done->frame=state->renderer->Submitted()+1;
+      NanAssignPersistent(done->callback, Local<Function>::Cast(callback));
+    }
+
+    state->renderer->Submit(cmds, length, done);
+    NanReturnValue(JS_NUM(state->renderer->Submitted()));
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(WindowShouldClose) {
+NAN_METHOD(StopRenderThread) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    NanReturnValue(JS_INT(glfwWindowShouldClose(window)));
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!OnRenderThread(state))
+      NanReturnUndefined();
+
+    delete state->renderer;
+    state->renderer=NULL;
+    // the thread may have changed the interval with RENDER_SWAP_INTERVAL
+    state->appliedInterval=-1;
+    glfwMakeContextCurrent(window);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(SetWindowShouldClose) {
+NAN_METHOD(GetRenderThreadStats) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  int value=args[1]->Uint32Value();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwSetWindowShouldClose(window, value);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!OnRenderThread(state))
+      NanReturnUndefined();
+
+    RenderThread *renderer=state->renderer;
+    Local<Object> stats=Object::New(v8::Isolate::GetCurrent());
+    stats->Set(JS_STR("submitted"), JS_NUM(renderer->Submitted()));
+    stats->Set(JS_STR("completed"), JS_NUM(renderer->Completed()));
+    stats->Set(JS_STR("submitWait"), JS_NUM(renderer->SubmitWait()*1000));
+    NanReturnValue(stats);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(GetWindowAttrib) {
+/* Latency percentiles in milliseconds */
+NAN_METHOD(GetInputLatency) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  int attrib=args[1]->Uint32Value();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    NanReturnValue(JS_INT(glfwGetWindowAttrib(window, attrib)));
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    LatencyTracker &latency=state->latency;
+    Local<Object> stats=Object::New(v8::Isolate::GetCurrent());
+    stats->Set(JS_STR("count"), JS_NUM(latency.Count()));
+    stats->Set(JS_STR("total"), JS_NUM(latency.Total()));
+    stats->Set(JS_STR("p50"), JS_NUM(latency.Percentile(0.5)*1000));
+    stats->Set(JS_STR("p90"), JS_NUM(latency.Percentile(0.9)*1000));
+    stats->Set(JS_STR("p99"), JS_NUM(latency.Percentile(0.99)*1000));
+    stats->Set(JS_STR("max"), JS_NUM(latency.Percentile(1)*1000));
+
+    if(args.Length()>1 && args[1]->BooleanValue())
+      latency.Reset();
+    NanReturnValue(stats);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(PollEvents) {
-  NanScope();
-  glfwPollEvents();
-  NanReturnUndefined();
+/*
+ * Native frame loop: RunLoop(window, onFrame[, options]) runs poll, close
+ * check, framebuffer size query, onFrame(info) and swap in C++ and yields to
+ * libuv between frames with a 0ms timer. onFrame gets the same Float64Array
+ * every frame, see FrameInfo in window.h. The loop stops when the window
+ * should close, onFrame returns false or throws, or StopLoop is called.
+ *
+ *   options.poll   poll events before each frame (true)
+ *   options.swap   swap buffers after each frame (true)
+ *   options.done   called once the loop has stopped
+ *   options.fps    pace frames, see SetFramePacing for minFps and adaptive
+ */
+// onDone runs here, once the window's teardown is over, it may destroy the
+// window or terminate
+void frameLoopCloseCB(uv_handle_t *handle) {
+  FrameLoop *loop=(FrameLoop*) handle->data;
+  if(!loop->onDone.IsEmpty()) {
+    NanScope();
+    Local<Function> done=NanNew(loop->onDone);
+    loop->onDone.Reset();
+    NanMakeCallback(NanGetCurrentContext()->Global(), done, 0, NULL);
+  }
+  delete loop;
 }
 
-NAN_METHOD(WaitEvents) {
-  NanScope();
-  glfwWaitEvents();
-  NanReturnUndefined();
+void StopFrameLoop(WindowState *state) {
+  FrameLoop *loop=state->loop;
+  if(!loop) return;
+  state->loop=NULL;
+  loop->running=false;
+  uv_timer_stop(&loop->timer);
+
+  // no JS here, this runs from ~WindowState
+  if(!loop->infoView.IsEmpty())
+    NanNew(loop->infoView)->Buffer()->Neuter();
+  loop->onFrame.Reset();
+  loop->infoView.Reset();
+  uv_close((uv_handle_t*) &loop->timer, frameLoopCloseCB);
 }
 
-/* Input handling */
-NAN_METHOD(GetKey) {
+void frameLoopCB(uv_timer_t *handle);
+
+// pace and swap, then schedule the next frame
+void FinishFrame(FrameLoop *loop) {
+  GLFWwindow *window=loop->window;
+  WindowState *state=GetWindowState(window);
+  PaceFrame(state);
+  // with a render thread onFrame submits the swap
+  if(loop->swap && !OnRenderThread(state)) {
+    restoreSwapInterval(window, state);
+    glfwSwapBuffers(window);
+    LimitFramesInFlight(window, state);
+    TrackLatency(window);
+  }
+  uv_timer_start(&loop->timer, frameLoopCB, 0, 0);
+}
+
+void frameLoopCB(uv_timer_t *handle) {
+  FrameLoop *loop=(FrameLoop*) handle->data;
+  GLFWwindow *window=loop->window;
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  int key=args[1]->Uint32Value();
-  if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    NanReturnValue(JS_INT(glfwGetKey(window, key)));
+
+  if(loop->swapPending) {
+    loop->swapPending=false;
+    FinishFrame(loop);
+    return;
   }
-  NanReturnUndefined();
+
+  if(loop->poll) {
+    glfwPollEvents();
+    ProcessEvents();
+  }
+  // listeners may have stopped the loop or destroyed the window
+  if(!loop->running)
+    return;
+  if(glfwWindowShouldClose(window)) {
+    StopFrameLoop(GetWindowState(window));
+    return;
+  }
+
+  WindowState *state=GetWindowState(window);
+  double delay=ThrottleDelay(window, state);
+  if(delay!=0) {
+    uv_timer_start(&loop->timer, frameLoopCB, (uint64_t) ((delay<0 || delay>0.1 ? 0.1 : delay)*1000), 0);
+    return;
+  }
+  state->throttle.lastFrame=glfwGetTime();
+
+  int w,h;
+  glfwGetFramebufferSize(window, &w, &h);
+  double now=glfwGetTime();
+  double *info=loop->info;
+  info[FRAME_DT]=info[FRAME_INDEX]>=0 ? now-info[FRAME_TIME] : 0;
+  info[FRAME_TIME]=now;
+  info[FRAME_FB_WIDTH]=w;
+  info[FRAME_FB_HEIGHT]=h;
+  info[FRAME_INDEX]++;
+
+  if(glfwGetCurrentContext()!=window && !OnRenderThread(state))
+    glfwMakeContextCurrent(window);
+
+  // MakeCallback would report a throw and carry on, a throw stops the loop
+  Local<Value> argv[1] = { NanNew(loop->infoView) };
+  TryCatch tc;
+  Local<Value> ret=NanNew(loop->onFrame)->Call(NanGetCurrentContext()->Global(), 1, argv);
+  if(tc.HasCaught()) {
+    if(loop->running)
+      StopFrameLoop(GetWindowState(window));
+    FatalException(tc);
+    return;
+  }
+  if(!loop->running)
+    return;
+  if(ret->IsBoolean() && !ret->BooleanValue()) {
+    StopFrameLoop(GetWindowState(window));
+    return;
+  }
+
+  // wait for a paced deadline in libuv, only the last bit is spun
+  FramePacer &pacer=state->pacer;
+  double remaining=pacer.Active() ? pacer.Remaining(glfwGetTime()) : 0;
+  if(remaining>pacer.Spin()) {
+    loop->swapPending=true;
+    uv_timer_start(&loop->timer, frameLoopCB, (uint64_t) ((remaining-pacer.Spin())*1000), 0);
+    return;
+  }
+  FinishFrame(loop);
 }
 
-NAN_METHOD(GetMouseButton) {
+NAN_METHOD(RunLoop) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  int button=args[1]->Uint32Value();
+  int handle=args[0]->Int32Value();
+  if(!args[1]->IsFunction())
+    return NanThrowTypeError("onFrame must be a function");
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    NanReturnValue(JS_INT(glfwGetMouseButton(window, button)));
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+    StopFrameLoop(state);
+
+    FrameLoop *loop=new FrameLoop();
+    loop->window=window;
+    loop->running=true;
+    loop->poll=loop->swap=true;
+    loop->swapPending=false;
+    memset(loop->info, 0, sizeof(loop->info));
+    loop->info[FRAME_INDEX]=-1;
+
+    if(args.Length()>2 && args[2]->IsObject()) {
+      Local<Object> options=args[2]->ToObject();
+      Local<Value> val=options->Get(JS_STR("poll"));
+      if(!val->IsUndefined()) loop->poll=val->BooleanValue();
+      val=options->Get(JS_STR("swap"));
+      if(!val->IsUndefined()) loop->swap=val->BooleanValue();
+      val=options->Get(JS_STR("done"));
+      if(val->IsFunction()) NanAssignPersistent(loop->onDone, Local<Function>::Cast(val));
+      val=options->Get(JS_STR("fps"));
+      if(val->IsNumber()) ConfigurePacing(state, val->NumberValue(), options);
+    }
+
+    Local<ArrayBuffer> buffer=ArrayBuffer::New(v8::Isolate::GetCurrent(), loop->info, sizeof(loop->info));
+    NanAssignPersistent(loop->infoView, Float64Array::New(buffer, 0, FRAME_INFO_SIZE));
+    NanAssignPersistent(loop->onFrame, Local<Function>::Cast(args[1]));
+
+    uv_timer_init(uv_default_loop(), &loop->timer);
+    loop->timer.data=loop;
+    uv_timer_start(&loop->timer, frameLoopCB, 0, 0);
+    state->loop=loop;
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(GetCursorPos) {
+NAN_METHOD(StopLoop) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    double x,y;
-    glfwGetCursorPos(window, &x, &y);
-    Local<Array> arr=Array::New(v8::Isolate::GetCurrent(),2);
-    arr->Set(JS_STR("x"),JS_INT(x));
-    arr->Set(JS_STR("y"),JS_INT(y));
-    NanReturnValue(arr);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(state)
+      StopFrameLoop(state);
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(SetCursorPos) {
+NAN_METHOD(SwapInterval) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  int x=args[1]->NumberValue();
-  int y=args[2]->NumberValue();
-  if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwSetCursorPos(window, x, y);
-  }
+  int interval=args[0]->Int32Value();
+  glfwSwapInterval(interval);
+
+  // remembered to pace animation frames
+  GLFWwindow *window=glfwGetCurrentContext();
+  WindowState *state=window ? GetWindowState(window) : NULL;
+  if(state)
+    state->swapInterval=state->appliedInterval=interval;
   NanReturnUndefined();
 }
 
-/* @Module Context handling */
-NAN_METHOD(MakeContextCurrent) {
+/*
+ * requestAnimationFrame: callbacks are queued per window and all run in one
+ * batch per display frame, paced by the refresh rate of the window's monitor
+ * (or the primary one) times the swap interval. The timer only runs while
+ * callbacks are queued, and batches are held back while the window is
+ * iconified or hidden. Events are polled before each batch.
+ */
+int nextFrameId=1;
+
+double FramePeriod(GLFWwindow *window, WindowState *state) {
+  GLFWmonitor *monitor=glfwGetWindowMonitor(window);
+  if(!monitor)
+    monitor=glfwGetPrimaryMonitor();
+  const GLFWvidmode *mode=monitor ? glfwGetVideoMode(monitor) : NULL;
+  int rate=mode && mode->refreshRate>0 ? mode->refreshRate : 60;
+  int interval=state->swapInterval>1 ? state->swapInterval : 1;
+  return (double) interval/rate;
+}
+
+void animationFramesCB(uv_timer_t *handle);
+
+void ScheduleAnimationFrames(AnimationFrames *frames, double delay) {
+  frames->scheduled=true;
+  uv_timer_start(&frames->timer, animationFramesCB, (uint64_t) (delay*1000+0.5), 0);
+}
+
+void animationFramesCB(uv_timer_t *handle) {
+  AnimationFrames *frames=(AnimationFrames*) handle->data;
+  GLFWwindow *window=frames->window;
+  frames->scheduled=false;
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
-  if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
+
+  glfwPollEvents();
+  ProcessEvents();
+  // a listener may have destroyed the window
+  if(!frames->window)
+    return;
+
+  WindowState *state=GetWindowState(window);
+  double now=glfwGetTime();
+  double period=FramePeriod(window, state);
+
+  double delay;
+  if(state->throttle.enabled)
+    delay=ThrottleDelay(window, state);
+  else
+    delay=glfwGetWindowAttrib(window, GLFW_ICONIFIED) || !glfwGetWindowAttrib(window, GLFW_VISIBLE) ? -1 : 0;
+  if(delay!=0) {
+    // nothing is shown or the window is throttled, check again later
+    double wait=delay<0 || delay>0.25 ? 0.25 : delay;
+    frames->nextFrame=now+wait;
+    ScheduleAnimationFrames(frames, wait);
+    return;
+  }
+  state->throttle.lastFrame=now;
+
+  frames->firing.swap(frames->pending);
+  frames->nextFrame=std::max(frames->nextFrame+period, now+period*0.5);
+
+  if(glfwGetCurrentContext()!=window && !OnRenderThread(state))
     glfwMakeContextCurrent(window);
+
+  Local<Value> argv[1] = { JS_NUM(now*1000) };
+  Local<Object> global=NanGetCurrentContext()->Global();
+  for(size_t i=0; i<frames->firing.size(); i++) {
+    Persistent<Function> *fn=frames->firing[i].fn;
+    if(!fn) continue;
+    frames->firing[i].fn=NULL;
+    Local<Function> cb=NanNew(*fn);
+    fn->Reset();
+    delete fn;
+    // like in browsers a throwing callback doesn't cancel the others
+    TryCatch tc;
+    cb->Call(global, 1, argv);
+    if(tc.HasCaught())
+      FatalException(tc);
   }
-  NanReturnUndefined();
+  frames->firing.clear();
+
+  if(frames->window && !frames->pending.empty())
+    ScheduleAnimationFrames(frames, std::max(frames->nextFrame-glfwGetTime(), 0.0));
 }
 
-NAN_METHOD(GetCurrentContext) {
-  NanScope();
-  GLFWwindow* window=glfwGetCurrentContext();
-  NanReturnValue(JS_NUM((uint64_t) window));
+void animationFramesCloseCB(uv_handle_t *handle) {
+  delete (AnimationFrames*) handle->data;
 }
 
-NAN_METHOD(SwapBuffers) {
+static void releaseFrameCallbacks(std::vector<FrameCallback> &list) {
+  for(size_t i=0; i<list.size(); i++) {
+    if(list[i].fn) {
+      list[i].fn->Reset();
+      delete list[i].fn;
+      list[i].fn=NULL;
+    }
+  }
+}
+
+void StopAnimationFrames(WindowState *state) {
+  AnimationFrames *frames=state->frames;
+  if(!frames) return;
+  state->frames=NULL;
+  frames->window=NULL;
+  uv_timer_stop(&frames->timer);
+  releaseFrameCallbacks(frames->pending);
+  releaseFrameCallbacks(frames->firing);
+  frames->pending.clear();
+  uv_close((uv_handle_t*) &frames->timer, animationFramesCloseCB);
+}
+
+// RequestAnimationFrame(window, callback), returns an id for CancelAnimationFrame
+NAN_METHOD(RequestAnimationFrame) {
   NanScope();
-  uint64_t handle=args[0]->IntegerValue();
+  int handle=args[0]->Int32Value();
+  if(!args[1]->IsFunction())
+    return NanThrowTypeError("callback must be a function");
   if(handle) {
-    GLFWwindow* window = reinterpret_cast<GLFWwindow*>(handle);
-    glfwSwapBuffers(window);
+    REQ_WINDOW(handle, window);
+    WindowState *state=GetWindowState(window);
+    if(!state)
+      NanReturnUndefined();
+
+    AnimationFrames *frames=state->frames;
+    if(!frames) {
+      frames=state->frames=new AnimationFrames();
+      frames->window=window;
+      frames->scheduled=false;
+      frames->nextFrame=glfwGetTime();
+      uv_timer_init(uv_default_loop(), &frames->timer);
+      frames->timer.data=frames;
+    }
+
+    FrameCallback cb;
+    cb.id=nextFrameId++;
+    cb.fn=new Persistent<Function>();
+    NanAssignPersistent(*cb.fn, Local<Function>::Cast(args[1]));
+    frames->pending.push_back(cb);
+
+    if(!frames->scheduled)
+      ScheduleAnimationFrames(frames, std::max(frames->nextFrame-glfwGetTime(), 0.0));
+    NanReturnValue(JS_INT(cb.id));
   }
   NanReturnUndefined();
 }
 
-NAN_METHOD(SwapInterval) {
+static bool cancelFrameCallback(std::vector<FrameCallback> &list, int id) {
+  for(size_t i=0; i<list.size(); i++) {
+    if(list[i].id==id && list[i].fn) {
+      list[i].fn->Reset();
+      delete list[i].fn;
+      list[i].fn=NULL;
+      return true;
+    }
+  }
+  return false;
+}
+
+NAN_METHOD(CancelAnimationFrame) {
   NanScope();
-  int interval=args[0]->Int32Value();
-  glfwSwapInterval(interval);
+  int id=args[0]->Int32Value();
+  for(size_t i=0; i<windows.size(); i++) {
+    WindowState *state=GetWindowState(windows[i]);
+    if(state && state->frames &&
+       (cancelFrameCallback(state->frames->pending, id) || cancelFrameCallback(state->frames->firing, id)))
+      break;
+  }
   NanReturnUndefined();
 }
 
@@ -939,12 +3064,25 @@ void AtExit() {
 ///////////////////////////////////////////////////////////////////////////////
 #define JS_GLFW_CONSTANT(name) target->Set(JS_STR( #name ), JS_INT(GLFW_ ## name))
 #define JS_GLFW_SET_METHOD(name) NODE_SET_METHOD(target, #name , glfw::name);
+#define JS_EVENT_CONSTANT(name) target->Set(JS_STR( "EVENT_" #name ), JS_INT(glfw::EVENT_ ## name))
 
 extern "C" {
 void init(Handle<Object> target) {
+  NanScope();
+
+  // windows, listeners and event templates are process wide and tied to
+  // the isolate of the main thread, which is also the only one GLFW allows
+  static Isolate *mainIsolate=NULL;
+  if(mainIsolate && mainIsolate!=Isolate::GetCurrent()) {
+    NanThrowError("glfw can only be loaded by the main thread");
+    return;
+  }
+  mainIsolate=Isolate::GetCurrent();
+
   atexit(glfw::AtExit);
+  glfw::mainThread.Init(uv_default_loop());
 
-  NanScope();
+  glfw::InitEvents();
 
   /* GLFW initialization, termination and version querying */
   JS_GLFW_SET_METHOD(Init);
@@ -965,6 +3103,8 @@ void init(Handle<Object> target) {
   JS_GLFW_SET_METHOD(WindowHint);
   JS_GLFW_SET_METHOD(DefaultWindowHints);
   JS_GLFW_SET_METHOD(DestroyWindow);
+  JS_GLFW_SET_METHOD(SetWindowPoolSize);
+  JS_GLFW_SET_METHOD(PrewarmWindows);
   JS_GLFW_SET_METHOD(SetWindowShouldClose);
   JS_GLFW_SET_METHOD(WindowShouldClose);
   JS_GLFW_SET_METHOD(SetWindowTitle);
@@ -976,21 +3116,58 @@ void init(Handle<Object> target) {
   JS_GLFW_SET_METHOD(IconifyWindow);
   JS_GLFW_SET_METHOD(RestoreWindow);
   JS_GLFW_SET_METHOD(ShowWindow);
+  JS_GLFW_SET_METHOD(ExecuteWindowCommands);
   JS_GLFW_SET_METHOD(HideWindow);
   JS_GLFW_SET_METHOD(GetWindowAttrib);
+  NODE_SET_METHOD(target, "GetWindowState", glfw::QueryWindowState);
   JS_GLFW_SET_METHOD(PollEvents);
   JS_GLFW_SET_METHOD(WaitEvents);
+  JS_GLFW_SET_METHOD(StartEventWatcher);
+  JS_GLFW_SET_METHOD(StopEventWatcher);
+  JS_GLFW_SET_METHOD(AddEventListener);
+  JS_GLFW_SET_METHOD(RemoveEventListener);
+  JS_GLFW_SET_METHOD(RemoveAllEventListeners);
+  JS_GLFW_SET_METHOD(AddWindowEventListener);
+  JS_GLFW_SET_METHOD(RemoveWindowEventListener);
+  JS_GLFW_SET_METHOD(RemoveAllWindowEventListeners);
+  JS_GLFW_SET_METHOD(SetEventQueue);
+  JS_GLFW_SET_METHOD(SetEventObjectReuse);
+  JS_GLFW_SET_METHOD(SetEventCoalescing);
+  JS_GLFW_SET_METHOD(SetEventQueueLimit);
+  JS_GLFW_SET_METHOD(GetEventQueueStats);
 
   /* Input handling */
   JS_GLFW_SET_METHOD(GetKey);
   JS_GLFW_SET_METHOD(GetMouseButton);
   JS_GLFW_SET_METHOD(GetCursorPos);
   JS_GLFW_SET_METHOD(SetCursorPos);
+  JS_GLFW_SET_METHOD(SetRelativeMotion);
+  JS_GLFW_SET_METHOD(GetCursorDelta);
+  JS_GLFW_SET_METHOD(GetInputState);
+  JS_GLFW_SET_METHOD(BindAction);
+  JS_GLFW_SET_METHOD(ClearActions);
+  JS_GLFW_SET_METHOD(GetActionState);
 
   /* Context handling */
   JS_GLFW_SET_METHOD(MakeContextCurrent);
   JS_GLFW_SET_METHOD(GetCurrentContext);
   JS_GLFW_SET_METHOD(SwapBuffers);
+  JS_GLFW_SET_METHOD(SwapBuffersBatch);
+  JS_GLFW_SET_METHOD(StartRenderThread);
+  JS_GLFW_SET_METHOD(SubmitCommands);
+  JS_GLFW_SET_METHOD(StopRenderThread);
+  JS_GLFW_SET_METHOD(GetRenderThreadStats);
+  JS_GLFW_SET_METHOD(GetInputLatency);
+  JS_GLFW_SET_METHOD(SetFramePacing);
+  JS_GLFW_SET_METHOD(GetFramePacingStats);
+  JS_GLFW_SET_METHOD(SetMaxFramesInFlight);
+  JS_GLFW_SET_METHOD(GetFramesInFlightStats);
+  JS_GLFW_SET_METHOD(SetBackgroundThrottle);
+  JS_GLFW_SET_METHOD(ShouldRender);
+  JS_GLFW_SET_METHOD(RunLoop);
+  JS_GLFW_SET_METHOD(StopLoop);
+  JS_GLFW_SET_METHOD(RequestAnimationFrame);
+  JS_GLFW_SET_METHOD(CancelAnimationFrame);
   JS_GLFW_SET_METHOD(SwapInterval);
   JS_GLFW_SET_METHOD(ExtensionSupported);
 
@@ -1279,6 +3456,79 @@ void init(Handle<Object> target) {
   JS_GLFW_CONSTANT(CONNECTED);
   JS_GLFW_CONSTANT(DISCONNECTED);
 
+  /* Queued event records, see SetEventQueue */
+  JS_EVENT_CONSTANT(WINDOW_POS);
+  JS_EVENT_CONSTANT(RESIZE);
+  JS_EVENT_CONSTANT(FRAMEBUFFER_RESIZE);
+  JS_EVENT_CONSTANT(QUIT);
+  JS_EVENT_CONSTANT(REFRESH);
+  JS_EVENT_CONSTANT(ICONIFIED);
+  JS_EVENT_CONSTANT(FOCUSED);
+  JS_EVENT_CONSTANT(KEYUP);
+  JS_EVENT_CONSTANT(KEYDOWN);
+  JS_EVENT_CONSTANT(KEYPRESS);
+  JS_EVENT_CONSTANT(MOUSEMOVE);
+  JS_EVENT_CONSTANT(MOUSEENTER);
+  JS_EVENT_CONSTANT(MOUSEDOWN);
+  JS_EVENT_CONSTANT(MOUSEUP);
+  JS_EVENT_CONSTANT(MOUSEWHEEL);
+  target->Set(JS_STR("EVENT_RECORD_SIZE"), JS_INT(EVENT_RECORD_SIZE));
+
+  /* Action sources, see BindAction */
+  target->Set(JS_STR("ACTION_KEY"), JS_INT(glfw::ACTION_KEY));
+  target->Set(JS_STR("ACTION_MOUSE_BUTTON"), JS_INT(glfw::ACTION_MOUSE_BUTTON));
+  target->Set(JS_STR("ACTION_JOYSTICK_BUTTON"), JS_INT(glfw::ACTION_JOYSTICK_BUTTON));
+  target->Set(JS_STR("ACTION_JOYSTICK_AXIS"), JS_INT(glfw::ACTION_JOYSTICK_AXIS));
+  target->Set(JS_STR("ACTION_STATE_SIZE"), JS_INT(ACTION_STATE_SIZE));
+  target->Set(JS_STR("MAX_ACTIONS"), JS_INT(MAX_ACTIONS));
+
+  /* Render thread commands, see SubmitCommands */
+  target->Set(JS_STR("RENDER_VIEWPORT"), JS_INT(glfw::RENDER_VIEWPORT));
+  target->Set(JS_STR("RENDER_CLEAR_COLOR"), JS_INT(glfw::RENDER_CLEAR_COLOR));
+  target->Set(JS_STR("RENDER_CLEAR"), JS_INT(glfw::RENDER_CLEAR));
+  target->Set(JS_STR("RENDER_TEST_SCENE"), JS_INT(glfw::RENDER_TEST_SCENE));
+  target->Set(JS_STR("RENDER_SWAP_INTERVAL"), JS_INT(glfw::RENDER_SWAP_INTERVAL));
+  target->Set(JS_STR("RENDER_SWAP"), JS_INT(glfw::RENDER_SWAP));
+
+  /* Upper bound of SetMaxFramesInFlight */
+  target->Set(JS_STR("MAX_FRAMES_IN_FLIGHT"), JS_INT(MAX_FRAMES_IN_FLIGHT));
+
+  /* Window management commands, see ExecuteWindowCommands */
+  target->Set(JS_STR("WINDOW_CMD_POS"), JS_INT(glfw::WINDOW_CMD_POS));
+  target->Set(JS_STR("WINDOW_CMD_SIZE"), JS_INT(glfw::WINDOW_CMD_SIZE));
+  target->Set(JS_STR("WINDOW_CMD_TITLE"), JS_INT(glfw::WINDOW_CMD_TITLE));
+  target->Set(JS_STR("WINDOW_CMD_SHOW"), JS_INT(glfw::WINDOW_CMD_SHOW));
+  target->Set(JS_STR("WINDOW_CMD_HIDE"), JS_INT(glfw::WINDOW_CMD_HIDE));
+  target->Set(JS_STR("WINDOW_CMD_ICONIFY"), JS_INT(glfw::WINDOW_CMD_ICONIFY));
+  target->Set(JS_STR("WINDOW_CMD_RESTORE"), JS_INT(glfw::WINDOW_CMD_RESTORE));
+
+  /* Layout of GetWindowState's out array */
+  target->Set(JS_STR("WINDOW_STATE_WIDTH"), JS_INT(glfw::WINDOW_STATE_WIDTH));
+  target->Set(JS_STR("WINDOW_STATE_HEIGHT"), JS_INT(glfw::WINDOW_STATE_HEIGHT));
+  target->Set(JS_STR("WINDOW_STATE_X"), JS_INT(glfw::WINDOW_STATE_X));
+  target->Set(JS_STR("WINDOW_STATE_Y"), JS_INT(glfw::WINDOW_STATE_Y));
+  target->Set(JS_STR("WINDOW_STATE_FB_WIDTH"), JS_INT(glfw::WINDOW_STATE_FB_WIDTH));
+  target->Set(JS_STR("WINDOW_STATE_FB_HEIGHT"), JS_INT(glfw::WINDOW_STATE_FB_HEIGHT));
+  target->Set(JS_STR("WINDOW_STATE_CURSOR_X"), JS_INT(glfw::WINDOW_STATE_CURSOR_X));
+  target->Set(JS_STR("WINDOW_STATE_CURSOR_Y"), JS_INT(glfw::WINDOW_STATE_CURSOR_Y));
+  target->Set(JS_STR("WINDOW_STATE_FOCUSED"), JS_INT(glfw::WINDOW_STATE_FOCUSED));
+  target->Set(JS_STR("WINDOW_STATE_ICONIFIED"), JS_INT(glfw::WINDOW_STATE_ICONIFIED));
+  target->Set(JS_STR("WINDOW_STATE_VISIBLE"), JS_INT(glfw::WINDOW_STATE_VISIBLE));
+  target->Set(JS_STR("WINDOW_STATE_CONTEXT_MAJOR"), JS_INT(glfw::WINDOW_STATE_CONTEXT_MAJOR));
+  target->Set(JS_STR("WINDOW_STATE_CONTEXT_MINOR"), JS_INT(glfw::WINDOW_STATE_CONTEXT_MINOR));
+  target->Set(JS_STR("WINDOW_STATE_CONTEXT_REVISION"), JS_INT(glfw::WINDOW_STATE_CONTEXT_REVISION));
+  target->Set(JS_STR("WINDOW_STATE_SIZE"), JS_INT(glfw::WINDOW_STATE_SIZE));
+
+  /* Coalescing policies, see SetEventCoalescing */
+  target->Set(JS_STR("COALESCE_NONE"), JS_INT(glfw::COALESCE_NONE));
+  target->Set(JS_STR("COALESCE_LATEST"), JS_INT(glfw::COALESCE_LATEST));
+  target->Set(JS_STR("COALESCE_SUM"), JS_INT(glfw::COALESCE_SUM));
+
+  /* Overflow policies, see SetEventQueueLimit */
+  target->Set(JS_STR("QUEUE_DROP_OLDEST"), JS_INT(glfw::QUEUE_DROP_OLDEST));
+  target->Set(JS_STR("QUEUE_DROP_COALESCIBLE"), JS_INT(glfw::QUEUE_DROP_COALESCIBLE));
+  target->Set(JS_STR("QUEUE_DROP_NEWEST"), JS_INT(glfw::QUEUE_DROP_NEWEST));
+
   // init AntTweakBar
   atb::AntTweakBar::Initialize(target);
   atb::Bar::Initialize(target);
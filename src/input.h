@@ -0,0 +1,287 @@
+/*
+ * input.h
+ *
+ * Native input records shared by the GLFW callbacks. Nothing in here touches
+ * V8 so callbacks can store events without crossing into JS.
+ */
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+namespace glfw {
+
+enum EventType {
+  EVENT_WINDOW_POS = 0,
+  EVENT_RESIZE,
+  EVENT_FRAMEBUFFER_RESIZE,
+  EVENT_QUIT,
+  EVENT_REFRESH,
+  EVENT_ICONIFIED,
+  EVENT_FOCUSED,
+  EVENT_KEYUP,      // GLFW_RELEASE
+  EVENT_KEYDOWN,    // GLFW_PRESS
+  EVENT_KEYPRESS,   // GLFW_REPEAT
+  EVENT_MOUSEMOVE,
+  EVENT_MOUSEENTER,
+  EVENT_MOUSEDOWN,
+  EVENT_MOUSEUP,
+  EVENT_MOUSEWHEEL,
+  EVENT_TYPE_COUNT
+};
+
+/*
+ * Fixed-size input record. All fields are doubles so a batch of records can be
+ * handed to JS as a single Float64Array with EVENT_RECORD_SIZE values per
+ * event.
+ *
+ *   type                  a          b          c        d
+ *   WINDOW_POS            xpos       ypos
+ *   RESIZE, FB_RESIZE     width      height
+ *   ICONIFIED             iconified
+ *   FOCUSED               focused
+ *   KEYUP/DOWN/PRESS      key        scancode   mods
+ *   MOUSEMOVE             x          y
+ *   MOUSEENTER            entered
+ *   MOUSEDOWN/UP          button     mods       x        y
+ *   MOUSEWHEEL            xoffset    yoffset
+ *
+ * time is the glfwGetTime() value when the callback ran.
+ */
+struct InputEvent {
+  double type;
+  double window;
+  double a, b, c, d;
+  double time;
+  double reserved;
+};
+
+#define EVENT_RECORD_SIZE (sizeof(glfw::InputEvent)/sizeof(double))
+
+/*
+ * Coalescing policies for high frequency events (cursor, scroll, resize).
+ * Coalesced events are delivered once per PollEvents/WaitEvents.
+ */
+enum CoalescePolicy {
+  COALESCE_NONE = 0,  // deliver every sample
+  COALESCE_LATEST,    // keep the last sample only
+  COALESCE_SUM        // accumulate a and b, scroll offsets only
+};
+
+static inline bool isCoalescible(int type) {
+  return type==EVENT_WINDOW_POS || type==EVENT_RESIZE || type==EVENT_FRAMEBUFFER_RESIZE ||
+         type==EVENT_MOUSEMOVE || type==EVENT_MOUSEWHEEL;
+}
+
+// scroll offsets add up, everything else keeps the latest value
+static inline void mergeEvent(InputEvent &into, const InputEvent &evt) {
+  if(evt.type==EVENT_MOUSEWHEEL) {
+    into.a+=evt.a;
+    into.b+=evt.b;
+    into.time=evt.time;
+  }
+  else
+    into=evt;
+}
+
+/* What a bounded queue does with a record that doesn't fit */
+enum OverflowPolicy {
+  QUEUE_DROP_OLDEST = 0,   // discard the oldest record
+  QUEUE_DROP_COALESCIBLE,  // merge or discard cursor/scroll/resize records first
+  QUEUE_DROP_NEWEST        // discard the incoming record, only count it
+};
+
+/* Per event type counters, see GetEventQueueStats */
+struct EventStats {
+  double dropped[EVENT_TYPE_COUNT];
+  double coalesced[EVENT_TYPE_COUNT];
+  size_t highWater;
+
+  EventStats() { Reset(); }
+  void Reset() {
+    memset(dropped, 0, sizeof(dropped));
+    memset(coalesced, 0, sizeof(coalesced));
+    highWater=0;
+  }
+};
+
+/*
+ * Ring buffer of input records. It grows by doubling up to its limit, an
+ * unlimited queue never loses events between two drains.
+ */
+class EventQueue {
+public:
+  EventQueue() : records(NULL), capacity(0), head(0), count(0), limit(0), policy(QUEUE_DROP_OLDEST) {}
+  ~EventQueue() { free(records); }
+
+  size_t Size() const { return count; }
+  size_t Capacity() const { return capacity; }
+  size_t Limit() const { return limit; }
+
+  // 0 means unbounded
+  void SetLimit(size_t maxEvents, int overflow, EventStats &stats) {
+    limit=maxEvents;
+    policy=overflow;
+    while(limit && count>limit)
+      DropAt(0, stats);
+  }
+
+  void Push(const InputEvent &evt, EventStats &stats) {
+    if(limit && count>=limit && !Overflow(evt, stats))
+      return;
+    if(count==capacity)
+      Grow();
+    records[(head+count) % capacity]=evt;
+    count++;
+    if(count>stats.highWater)
+      stats.highWater=count;
+  }
+
+  // copy up to max records, oldest first, into out and remove them
+  size_t Drain(InputEvent *out, size_t max) {
+    size_t n = count<max ? count : max;
+    for(size_t i=0; i<n; i++)
+      out[i]=At(i);
+    if(n) head=(head+n) % capacity;
+    count-=n;
+    return n;
+  }
+
+  void Clear() { head=count=0; }
+
+private:
+  InputEvent &At(size_t i) { return records[(head+i) % capacity]; }
+
+  void DropAt(size_t i, EventStats &stats) {
+    stats.dropped[(int) At(i).type]++;
+    for(; i>0; i--)
+      At(i)=At(i-1);
+    head=(head+1) % capacity;
+    count--;
+  }
+
+  // make room for evt, returns false when evt has been dropped or merged
+  bool Overflow(const InputEvent &evt, EventStats &stats) {
+    int type=(int) evt.type;
+    if(policy==QUEUE_DROP_NEWEST) {
+      stats.dropped[type]++;
+      return false;
+    }
+
+    if(policy==QUEUE_DROP_COALESCIBLE) {
+      if(isCoalescible(type)) {
+        for(size_t i=count; i-- > 0; ) {
+          InputEvent &rec=At(i);
+          if(rec.type==evt.type && rec.window==evt.window) {
+            mergeEvent(rec, evt);
+            stats.coalesced[type]++;
+            return false;
+          }
+        }
+      }
+      for(size_t i=0; i<count; i++) {
+        if(isCoalescible((int) At(i).type)) {
+          DropAt(i, stats);
+          return true;
+        }
+      }
+    }
+
+    DropAt(0, stats);
+    return true;
+  }
+
+  void Grow() {
+    size_t newCapacity = capacity ? capacity*2 : 256;
+    if(limit && newCapacity>limit)
+      newCapacity=limit;
+    InputEvent *newRecords=(InputEvent*) malloc(newCapacity*sizeof(InputEvent));
+    for(size_t i=0; i<count; i++)
+      newRecords[i]=At(i);
+    free(records);
+    records=newRecords;
+    capacity=newCapacity;
+    head=0;
+  }
+
+  InputEvent *records;
+  size_t capacity, head, count;
+  size_t limit;
+  int policy;
+};
+
+struct CoalescedEvent {
+  bool pending;
+  InputEvent rec;
+  std::vector<double> samples;  // raw (a,b) pairs, only filled when history is kept
+
+  CoalescedEvent() : pending(false) {}
+
+  void Merge(const InputEvent &evt, int policy, bool keepSamples) {
+    if(!pending) {
+      rec=evt;
+      pending=true;
+      samples.clear();
+    }
+    else if(policy==COALESCE_SUM) {
+      rec.a+=evt.a;
+      rec.b+=evt.b;
+      rec.time=evt.time;
+    }
+    else
+      rec=evt;
+
+    if(keepSamples) {
+      samples.push_back(evt.a);
+      samples.push_back(evt.b);
+    }
+  }
+};
+
+/*
+ * Keeps the most recent latency samples, in seconds, and reports
+ * percentiles over them.
+ */
+class LatencyTracker {
+public:
+  LatencyTracker() : next(0), total(0) {}
+
+  void Add(double sample) {
+    if(samples.size()<MAX_SAMPLES)
+      samples.push_back(sample);
+    else
+      samples[next]=sample;
+    next=(next+1) % MAX_SAMPLES;
+    total++;
+  }
+
+  size_t Count() const { return samples.size(); }
+  size_t Total() const { return total; }
+
+  // p in [0,1], sorts a copy so it's meant for reporting, not per frame use
+  double Percentile(double p) const {
+    if(samples.empty()) return 0;
+    std::vector<double> sorted(samples);
+    size_t i=(size_t) (p*(sorted.size()-1)+0.5);
+    std::nth_element(sorted.begin(), sorted.begin()+i, sorted.end());
+    return sorted[i];
+  }
+
+  void Reset() {
+    samples.clear();
+    next=total=0;
+  }
+
+private:
+  static const size_t MAX_SAMPLES=1024;
+  std::vector<double> samples;
+  size_t next, total;
+};
+
+} // namespace glfw
+
+#endif /* INPUT_H_ */
@@ -0,0 +1,56 @@
+/*
+ * mainthread.cc
+ *
+ */
+
+#include "mainthread.h"
+
+#include <cassert>
+
+namespace glfw {
+
+MainThreadQueue mainThread;
+
+void MainThreadQueue::Init(uv_loop_t *loop) {
+  if(initialized) return;
+  mainThread=uv_thread_self();
+  uv_mutex_init(&mutex);
+  uv_async_init(loop, &async, AsyncCB);
+  async.data=this;
+  // pending tasks alone don't keep the process alive
+  uv_unref((uv_handle_t*) &async);
+  initialized=true;
+}
+
+bool MainThreadQueue::IsMainThread() const {
+  uv_thread_t self=uv_thread_self();
+  return initialized && uv_thread_equal(&self, &mainThread);
+}
+
+void MainThreadQueue::Post(Task task, void *data) {
+  Entry e;
+  e.task=task;
+  e.data=data;
+  uv_mutex_lock(&mutex);
+  tasks.push_back(e);
+  uv_mutex_unlock(&mutex);
+  // several sends may be coalesced into one callback
+  uv_async_send(&async);
+}
+
+void MainThreadQueue::AsyncCB(uv_async_t *handle) {
+  ((MainThreadQueue*) handle->data)->Run();
+}
+
+void MainThreadQueue::Run() {
+  assert(IsMainThread());
+  uv_mutex_lock(&mutex);
+  running.swap(tasks);
+  uv_mutex_unlock(&mutex);
+
+  for(size_t i=0; i<running.size(); i++)
+    running[i].task(running[i].data);
+  running.clear();
+}
+
+} // namespace glfw
@@ -0,0 +1,49 @@
+/*
+ * mainthread.h
+ *
+ * GLFW and V8 may only be used from the main thread. Native threads (see
+ * renderer.h) post tasks here and they run on the main libuv loop.
+ */
+
+#ifndef MAINTHREAD_H_
+#define MAINTHREAD_H_
+
+#include "common.h"
+
+#include <vector>
+
+namespace glfw {
+
+class MainThreadQueue {
+public:
+  typedef void (*Task)(void *data);
+
+  // on the main thread, once
+  void Init(uv_loop_t *loop);
+  bool IsMainThread() const;
+
+  // from any thread, task(data) runs on the main thread soon after
+  void Post(Task task, void *data);
+
+private:
+  static void AsyncCB(uv_async_t *handle);
+  void Run();
+
+  struct Entry {
+    Task task;
+    void *data;
+  };
+
+  bool initialized;
+  uv_thread_t mainThread;
+  uv_async_t async;
+  uv_mutex_t mutex;
+  std::vector<Entry> tasks;    // guarded by mutex
+  std::vector<Entry> running;
+};
+
+extern MainThreadQueue mainThread;
+
+} // namespace glfw
+
+#endif /* MAINTHREAD_H_ */
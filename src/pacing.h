@@ -0,0 +1,105 @@
+/*
+ * pacing.h
+ *
+ * Frame pacing towards a target frame rate. Like input.h this doesn't touch
+ * V8 or GLFW, the caller supplies the clock (glfwGetTime) and does the
+ * waiting.
+ */
+
+#ifndef PACING_H_
+#define PACING_H_
+
+#include <cmath>
+#include <cstddef>
+
+#include "input.h"
+
+namespace glfw {
+
+class FramePacer {
+public:
+  FramePacer() : target(0), period(0), minPeriod(0), maxPeriod(0), spin(0.002),
+                 adaptive(false), deadline(-1), frames(0), missed(0),
+                 windowFrames(0), windowMissed(0) {}
+
+  bool Active() const { return target>0; }
+
+  // fps 0 disables pacing, minFps bounds the adaptive rate
+  void Configure(double fps, double minFps, bool adapt, double spinTime) {
+    target=fps>0 ? fps : 0;
+    period=minPeriod=target ? 1/target : 0;
+    maxPeriod=minFps>0 && minFps<target ? 1/minFps : minPeriod;
+    adaptive=adapt && maxPeriod>minPeriod;
+    spin=spinTime>=0 ? spinTime : 0;
+    deadline=-1;
+    windowFrames=windowMissed=0;
+  }
+
+  double Target() const { return target; }
+  double Rate() const { return period>0 ? 1/period : 0; }
+  double Spin() const { return spin; }
+  size_t Frames() const { return frames; }
+  size_t Missed() const { return missed; }
+  const LatencyTracker &Jitter() const { return jitter; }
+
+  // seconds left until the next deadline, 0 when it has passed
+  double Remaining(double now) const {
+    return deadline>now ? deadline-now : 0;
+  }
+
+  // the frame reached its deadline (or is late) at time now
+  void FrameDone(double now) {
+    if(deadline<0) {
+      deadline=now+period;
+      return;
+    }
+
+    double late=now-deadline;
+    jitter.Add(std::fabs(late));
+    frames++;
+    windowFrames++;
+    if(late>std::min(0.001, period*0.1)) {
+      missed++;
+      windowMissed++;
+    }
+
+    // after an overrun of a whole frame start over rather than catching up
+    if(late>period)
+      deadline=now+period;
+    else
+      deadline+=period;
+
+    if(adaptive && windowFrames>=ADAPT_FRAMES)
+      Adapt();
+  }
+
+  void ResetStats() {
+    frames=missed=0;
+    jitter.Reset();
+  }
+
+private:
+  static const size_t ADAPT_FRAMES=60;
+
+  // lower the rate when more than 10% of the frames miss, raise it back when none do
+  void Adapt() {
+    if(windowMissed*10>windowFrames)
+      period=std::min(period*1.25, maxPeriod);
+    else if(windowMissed==0)
+      period=std::max(period*0.9, minPeriod);
+    windowFrames=windowMissed=0;
+  }
+
+  double target;
+  double period, minPeriod, maxPeriod;
+  double spin;
+  bool adaptive;
+  double deadline;
+  size_t frames, missed;
+  size_t windowFrames, windowMissed;
+  LatencyTracker jitter;
+};
+
+} // namespace glfw
+
+#endif /* PACING_H_ */
@@ -0,0 +1,140 @@
+/*
+ * renderer.cc
+ *
+ */
+
+#include "renderer.h"
+
+#include <cassert>
+
+namespace glfw {
+
+int RenderCommandArgs(int op) {
+  switch(op) {
+  case RENDER_VIEWPORT:      return 4;
+  case RENDER_CLEAR_COLOR:   return 4;
+  case RENDER_CLEAR:         return 1;
+  case RENDER_TEST_SCENE:    return 3;
+  case RENDER_SWAP_INTERVAL: return 1;
+  case RENDER_SWAP:          return 0;
+  }
+  return -1;
+}
+
+RenderThread::RenderThread(GLFWwindow *window, MainThreadQueue::Task onDone)
+  : window(window), onDone(onDone), running(false), quit(false), queuedTag(NULL), hasQueued(false),
+    submitted(0), completed(0), submitWait(0) {
+  uv_mutex_init(&mutex);
+  uv_cond_init(&cond);
+}
+
+RenderThread::~RenderThread() {
+  Stop();
+  uv_cond_destroy(&cond);
+  uv_mutex_destroy(&mutex);
+}
+
+// the main thread only, like Submit and Stop
+void RenderThread::Start() {
+  assert(mainThread.IsMainThread());
+  if(running) return;
+  quit=false;
+  running=true;
+  uv_thread_create(&thread, Run, this);
+}
+
+void RenderThread::Submit(const double *cmds, size_t length, void *tag) {
+  uv_mutex_lock(&mutex);
+  if(hasQueued) {
+    double start=glfwGetTime();
+    while(hasQueued)
+      uv_cond_wait(&cond, &mutex);
+    submitWait+=glfwGetTime()-start;
+  }
+  queued.assign(cmds, cmds+length);
+  queuedTag=tag;
+  hasQueued=true;
+  submitted++;
+  uv_cond_broadcast(&cond);
+  uv_mutex_unlock(&mutex);
+}
+
+void RenderThread::Stop() {
+  if(!running) return;
+  uv_mutex_lock(&mutex);
+  quit=true;
+  uv_cond_broadcast(&cond);
+  uv_mutex_unlock(&mutex);
+  uv_thread_join(&thread);
+  running=false;
+}
+
+double RenderThread::Completed() {
+  uv_mutex_lock(&mutex);
+  double n=completed;
+  uv_mutex_unlock(&mutex);
+  return n;
+}
+
+void RenderThread::Run(void *arg) {
+  RenderThread *self=(RenderThread*) arg;
+  glfwMakeContextCurrent(self->window);
+
+  uv_mutex_lock(&self->mutex);
+  for(;;) {
+    while(!self->hasQueued && !self->quit)
+      uv_cond_wait(&self->cond, &self->mutex);
+    if(!self->hasQueued)
+      break;
+
+    // take the frame and let JS queue the next one while we execute
+    self->executing.swap(self->queued);
+    void *tag=self->queuedTag;
+    self->hasQueued=false;
+    uv_cond_broadcast(&self->cond);
+    uv_mutex_unlock(&self->mutex);
+
+    self->Execute(self->executing);
+    if(tag)
+      mainThread.Post(self->onDone, tag);
+
+    uv_mutex_lock(&self->mutex);
+    self->completed++;
+  }
+  uv_mutex_unlock(&self->mutex);
+
+  glfwMakeContextCurrent(NULL);
+}
+
+// commands were validated by the binding when they were submitted
+void RenderThread::Execute(const std::vector<double> &cmds) {
+  const double *c=cmds.empty() ? NULL : &cmds[0];
+  size_t i=0, n=cmds.size();
+  while(i<n) {
+    int op=(int) c[i];
+    const double *a=c+i+1;
+    switch(op) {
+    case RENDER_VIEWPORT:
+      glViewport((GLint) a[0], (GLint) a[1], (GLsizei) a[2], (GLsizei) a[3]);
+      break;
+    case RENDER_CLEAR_COLOR:
+      glClearColor((GLfloat) a[0], (GLfloat) a[1], (GLfloat) a[2], (GLfloat) a[3]);
+      break;
+    case RENDER_CLEAR:
+      glClear((GLbitfield) a[0]);
+      break;
+    case RENDER_TEST_SCENE:
+      DrawTestScene((int) a[0], (int) a[1], (float) a[2]);
+      break;
+    case RENDER_SWAP_INTERVAL:
+      glfwSwapInterval((int) a[0]);
+      break;
+    case RENDER_SWAP:
+      glfwSwapBuffers(window);
+      break;
+    }
+    i+=1+RenderCommandArgs(op);
+  }
+}
+
+} // namespace glfw
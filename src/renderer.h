@@ -0,0 +1,87 @@
+/*
+ * renderer.h
+ *
+ * Optional render thread owning a window's GL context. JS records frames
+ * into a Float64Array of commands which are copied and executed on the
+ * thread, so recording frame N+1 overlaps with the driver work of frame N.
+ */
+
+#ifndef RENDERER_H_
+#define RENDERER_H_
+
+#include "common.h"
+#include "mainthread.h"
+
+#include <vector>
+
+namespace glfw {
+
+/*
+ * Recorded commands, each opcode followed by its arguments:
+ *
+ *   RENDER_VIEWPORT       x, y, width, height
+ *   RENDER_CLEAR_COLOR    r, g, b, a
+ *   RENDER_CLEAR          mask (GL_COLOR_BUFFER_BIT...)
+ *   RENDER_TEST_SCENE     width, height, z
+ *   RENDER_SWAP_INTERVAL  interval
+ *   RENDER_SWAP
+ */
+enum RenderCommand {
+  RENDER_VIEWPORT = 1,
+  RENDER_CLEAR_COLOR,
+  RENDER_CLEAR,
+  RENDER_TEST_SCENE,
+  RENDER_SWAP_INTERVAL,
+  RENDER_SWAP,
+  RENDER_COMMAND_COUNT
+};
+
+// number of arguments of an opcode, -1 for an unknown opcode
+int RenderCommandArgs(int op);
+
+// what testScene draws, in the current context
+void DrawTestScene(int width, int height, float z);
+
+class RenderThread {
+public:
+  // onDone(tag) is posted to the main thread for each frame submitted with a tag
+  RenderThread(GLFWwindow *window, MainThreadQueue::Task onDone);
+  ~RenderThread();
+
+  // the calling thread must have released the window's context
+  void Start();
+
+  // copy a recorded frame for the thread, waits while the previous frame is
+  // still queued behind the one being executed
+  void Submit(const double *cmds, size_t length, void *tag=NULL);
+
+  // execute what is queued, then join the thread which releases the context
+  void Stop();
+
+  double Submitted() const { return submitted; }
+  double Completed();
+  double SubmitWait() const { return submitWait; }
+
+private:
+  static void Run(void *arg);
+  void Execute(const std::vector<double> &cmds);
+
+  GLFWwindow *window;
+  MainThreadQueue::Task onDone;
+  uv_thread_t thread;
+  uv_mutex_t mutex;
+  uv_cond_t cond;
+  bool running, quit;
+
+  std::vector<double> queued;     // guarded by mutex
+  void *queuedTag;
+  bool hasQueued;
+  std::vector<double> executing;  // owned by the thread
+
+  double submitted, completed;
+  double submitWait;  // seconds the JS thread waited in Submit
+};
+
+} // namespace glfw
+
+#endif /* RENDERER_H_ */
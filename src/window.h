@@ -0,0 +1,445 @@
+/*
+ * window.h
+ *
+ */
+
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+#include "common.h"
+#include "input.h"
+#include "pacing.h"
+#include "renderer.h"
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace v8;
+
+namespace glfw {
+
+/*
+ * Live input state of a window, kept up to date by the GLFW callbacks and
+ * shared with JS through typed array views (see GetInputState).
+ *
+ *   offset  view                          content
+ *   0       Float64Array(2)  cursor       x, y
+ *   16      Float64Array(2)  scroll       accumulated x, y offsets
+ *   32      Int32Array(1)    mods         GLFW_MOD_* of the last key/button
+ *   40      Uint8Array(8)    buttons      1 while a mouse button is down
+ *   48      Uint8Array(349)  keys         1 while a key is down, by GLFW_KEY_*
+ */
+struct InputState {
+  double cursor[2];
+  double scroll[2];
+  int32_t mods;
+  int32_t reserved;
+  uint8_t buttons[GLFW_MOUSE_BUTTON_LAST+1];
+  uint8_t keys[GLFW_KEY_LAST+1];
+};
+
+/*
+ * Action map: named actions bound to keys, mouse buttons and joystick
+ * buttons/axes, evaluated natively on each PollEvents/WaitEvents.
+ */
+#define MAX_ACTIONS 64
+
+enum ActionSource {
+  ACTION_KEY = 0,
+  ACTION_MOUSE_BUTTON,
+  ACTION_JOYSTICK_BUTTON,
+  ACTION_JOYSTICK_AXIS
+};
+
+struct ActionBinding {
+  int action;
+  int source;
+  int code;         // key, mouse button, joystick button or axis index
+  int joystick;
+  float threshold;  // axes: held above threshold, or below it when negative
+};
+
+// shared with JS as a Float32Array, see GetActionState
+struct ActionState {
+  float value;      // 1 for held keys/buttons, axis magnitude for axes
+  float pressed;    // 1 on the frame the action became active
+  float released;   // 1 on the frame the action became inactive
+};
+
+#define ACTION_STATE_SIZE (sizeof(glfw::ActionState)/sizeof(float))
+
+struct ActionMap {
+  std::vector<std::string> names;
+  std::vector<ActionBinding> bindings;
+  ActionState state[MAX_ACTIONS];
+
+  ActionMap() {
+    memset(state, 0, sizeof(state));
+  }
+
+  // index of the named action, created on first use, -1 when the map is full
+  int Find(const char *name) {
+    for(size_t i=0; i<names.size(); i++) {
+      if(names[i]==name)
+        return (int) i;
+    }
+    if(names.size()>=MAX_ACTIONS)
+      return -1;
+    names.push_back(name);
+    return (int) names.size()-1;
+  }
+
+  void Clear() {
+    names.clear();
+    bindings.clear();
+    memset(state, 0, sizeof(state));
+  }
+};
+
+/*
+ * Native frame loop, see RunLoop. Each frame polls, checks for close, calls
+ * onFrame with the frame info and swaps, then yields to libuv.
+ *
+ *   frame info (Float64Array)
+ *   0  dt             seconds since the previous frame
+ *   1  time           glfwGetTime() at the start of the frame
+ *   2  fbWidth        framebuffer size
+ *   3  fbHeight
+ *   4  frameIndex
+ */
+enum FrameInfo {
+  FRAME_DT = 0,
+  FRAME_TIME,
+  FRAME_FB_WIDTH,
+  FRAME_FB_HEIGHT,
+  FRAME_INDEX,
+  FRAME_INFO_SIZE
+};
+
+struct FrameLoop {
+  uv_timer_t timer;
+  GLFWwindow *window;
+  bool running;
+  bool poll, swap;
+  bool swapPending;  // waiting for the pacing deadline
+  double info[FRAME_INFO_SIZE];
+  Persistent<Function> onFrame;
+  Persistent<Function> onDone;
+  Persistent<Float64Array> infoView;
+};
+
+/*
+ * requestAnimationFrame queue of a window. Callbacks requested during a
+ * batch run in the next one, like in browsers.
+ */
+struct FrameCallback {
+  int id;
+  Persistent<Function> *fn;  // NULL once cancelled
+};
+
+struct AnimationFrames {
+  uv_timer_t timer;
+  GLFWwindow *window;
+  bool scheduled;
+  double nextFrame;
+  std::vector<FrameCallback> pending;
+  std::vector<FrameCallback> firing;
+};
+
+/*
+ * Fences inserted after each swap, at most max frames are left in flight,
+ * see SetMaxFramesInFlight.
+ */
+#define MAX_FRAMES_IN_FLIGHT 8
+
+struct FrameFences {
+  GLsync fences[MAX_FRAMES_IN_FLIGHT+1];
+  int max;  // 0 when disabled
+  int head, count;
+  LatencyTracker waits;
+
+  FrameFences() : max(0), head(0), count(0) {}
+};
+
+/*
+ * Background throttling: frame rates applied while a window is iconified,
+ * hidden or unfocused, in frames per second. 0 renders nothing, a negative
+ * rate doesn't throttle.
+ */
+struct BackgroundThrottle {
+  bool enabled;
+  bool iconified, focused;  // tracked by the iconify and focus callbacks
+  double iconifiedRate, hiddenRate, unfocusedRate;
+  double lastFrame;
+
+  BackgroundThrottle() : enabled(false), iconified(false), focused(true),
+                         iconifiedRate(0), hiddenRate(0), unfocusedRate(10), lastFrame(-1) {}
+
+  double Rate(bool visible) const {
+    if(!enabled) return -1;
+    if(iconified) return iconifiedRate;
+    if(!visible) return hiddenRate;
+    if(!focused) return unfocusedRate;
+    return -1;
+  }
+
+  // seconds until the next frame may render, 0 right away, -1 not at all
+  double Delay(bool visible, double now) const {
+    double rate=Rate(visible);
+    if(rate<0) return 0;
+    if(rate==0) return -1;
+    double next=lastFrame+1/rate;
+    return next>now ? next-now : 0;
+  }
+};
+
+/* Layout of GetWindowState's out array */
+enum WindowStateField {
+  WINDOW_STATE_WIDTH = 0,
+  WINDOW_STATE_HEIGHT,
+  WINDOW_STATE_X,
+  WINDOW_STATE_Y,
+  WINDOW_STATE_FB_WIDTH,
+  WINDOW_STATE_FB_HEIGHT,
+  WINDOW_STATE_CURSOR_X,
+  WINDOW_STATE_CURSOR_Y,
+  WINDOW_STATE_FOCUSED,
+  WINDOW_STATE_ICONIFIED,
+  WINDOW_STATE_VISIBLE,
+  WINDOW_STATE_CONTEXT_MAJOR,
+  WINDOW_STATE_CONTEXT_MINOR,
+  WINDOW_STATE_CONTEXT_REVISION,
+  WINDOW_STATE_SIZE
+};
+
+/*
+ * Window management commands for ExecuteWindowCommands, each opcode followed
+ * by a window handle and its arguments, all in one Int32Array:
+ *
+ *   WINDOW_CMD_POS      window, x, y
+ *   WINDOW_CMD_SIZE     window, width, height
+ *   WINDOW_CMD_TITLE    window, index in the title table
+ *   WINDOW_CMD_SHOW     window
+ *   WINDOW_CMD_HIDE     window
+ *   WINDOW_CMD_ICONIFY  window
+ *   WINDOW_CMD_RESTORE  window
+ */
+enum WindowCommand {
+  WINDOW_CMD_POS = 1,
+  WINDOW_CMD_SIZE,
+  WINDOW_CMD_TITLE,
+  WINDOW_CMD_SHOW,
+  WINDOW_CMD_HIDE,
+  WINDOW_CMD_ICONIFY,
+  WINDOW_CMD_RESTORE,
+  WINDOW_COMMAND_COUNT
+};
+
+// number of arguments of an opcode after the window, -1 for an unknown opcode
+static inline int WindowCommandArgs(int op) {
+  switch(op) {
+  case WINDOW_CMD_POS:     return 2;
+  case WINDOW_CMD_SIZE:    return 2;
+  case WINDOW_CMD_TITLE:   return 1;
+  case WINDOW_CMD_SHOW:    return 0;
+  case WINDOW_CMD_HIDE:    return 0;
+  case WINDOW_CMD_ICONIFY: return 0;
+  case WINDOW_CMD_RESTORE: return 0;
+  }
+  return -1;
+}
+
+struct WindowState;
+
+// stop and release the frame loop of a window, safe to call from onFrame,
+// onDone is called once the loop's timer is closed
+void StopFrameLoop(WindowState *state);
+
+// drop the pending animation frame callbacks of a window
+void StopAnimationFrames(WindowState *state);
+
+/* Native event listeners, called straight from C++ */
+struct ListenerList {
+  std::vector<Persistent<Function>*> fns;
+  int dispatching;
+  ListenerList() : dispatching(0) {}
+
+  // entries removed during dispatch stay in fns as NULL until it ends
+  bool Empty() const {
+    for(size_t i=0; i<fns.size(); i++) {
+      if(fns[i]) return false;
+    }
+    return true;
+  }
+
+  // entries become NULL, they are dropped once nothing dispatches the list
+  void Release() {
+    for(size_t i=0; i<fns.size(); i++) {
+      if(fns[i]) {
+        fns[i]->Reset();
+        delete fns[i];
+        fns[i]=NULL;
+      }
+    }
+  }
+};
+
+/*
+ * Windows are handed to JS as small integer handles, slot + generation *
+ * WINDOW_SLOTS. A destroyed window's slot gets a new generation when it is
+ * reused so stale handles are caught instead of dereferenced.
+ */
+#define WINDOW_SLOTS 1024
+#define WINDOW_GENERATIONS (1<<20)  // keeps handles in int32 range
+
+class WindowRegistry {
+public:
+  // 0 when all slots are taken
+  int Add(GLFWwindow *window) {
+    size_t slot;
+    if(!freeSlots.empty()) {
+      slot=freeSlots.back();
+      freeSlots.pop_back();
+    }
+    else {
+      if(slots.size()>=WINDOW_SLOTS)
+        return 0;
+      slot=slots.size();
+      slots.push_back(Slot());
+    }
+    Slot &s=slots[slot];
+    s.window=window;
+    s.generation=s.generation % (WINDOW_GENERATIONS-1) + 1;
+    return s.generation*WINDOW_SLOTS + (int) slot;
+  }
+
+  // NULL for 0 and for handles of destroyed windows
+  GLFWwindow *Get(int handle) const {
+    if(handle<=0) return NULL;
+    size_t slot=handle % WINDOW_SLOTS;
+    if(slot>=slots.size()) return NULL;
+    const Slot &s=slots[slot];
+    return s.generation==handle/WINDOW_SLOTS ? s.window : NULL;
+  }
+
+  void Remove(int handle) {
+    if(!Get(handle)) return;
+    size_t slot=handle % WINDOW_SLOTS;
+    slots[slot].window=NULL;
+    freeSlots.push_back(slot);
+  }
+
+private:
+  struct Slot {
+    GLFWwindow *window;
+    int generation;
+    Slot() : window(NULL), generation(0) {}
+  };
+
+  std::vector<Slot> slots;
+  std::vector<size_t> freeSlots;
+};
+
+extern WindowRegistry windowRegistry;
+
+/* Native state attached to each window with glfwSetWindowUserPointer */
+struct WindowState {
+  int handle;  // see WindowRegistry
+  int width, height;  // window size, kept by windowSizeCB
+  InputState input;
+
+  // listeners of this window's events, see AddWindowEventListener
+  ListenerList listeners[EVENT_TYPE_COUNT];
+
+  Persistent<Object> inputViews;
+  Persistent<ArrayBuffer> inputBuffer;
+
+  ActionMap actions;
+  Persistent<Float32Array> actionView;
+
+  // time of the newest input delivered to JS since the last swap
+  double newestInput;
+  LatencyTracker latency;
+
+  // relative motion mode, cursor deltas accumulated since the last read
+  bool relativeMotion;
+  double motion[2];
+  double motionLast[2];
+  double motionRead[2];
+  Persistent<Float64Array> motionView;
+
+  FrameLoop *loop;
+  AnimationFrames *frames;
+
+  FramePacer pacer;
+  FrameFences fences;
+  BackgroundThrottle throttle;
+
+  // window hints the window was created with, for the window pool
+  std::map<int,int> hints;
+
+  // set while the GL context lives on a render thread, see StartRenderThread
+  RenderThread *renderer;
+
+  // last SwapInterval asked for while this window's context was current, and
+  // the interval the context runs with (SwapBuffersBatch changes it), -1
+  // while unknown (drivers don't agree on the default)
+  int swapInterval;
+  int appliedInterval;
+
+  WindowState() : handle(0), width(0), height(0), newestInput(-1), relativeMotion(false), loop(NULL), frames(NULL), renderer(NULL), swapInterval(-1), appliedInterval(-1) {
+    memset(&input, 0, sizeof(input));
+    memset(motion, 0, sizeof(motion));
+    memset(motionLast, 0, sizeof(motionLast));
+    memset(motionRead, 0, sizeof(motionRead));
+  }
+  ~WindowState() {
+    StopFrameLoop(this);
+    StopAnimationFrames(this);
+    delete renderer;
+    for(int i=0; i<EVENT_TYPE_COUNT; i++)
+      listeners[i].Release();
+    // JS may still hold views on our memory, make sure they can't reach it
+    if(!inputBuffer.IsEmpty())
+      NanNew(inputBuffer)->Neuter();
+    if(!actionView.IsEmpty())
+      NanNew(actionView)->Buffer()->Neuter();
+    if(!motionView.IsEmpty())
+      NanNew(motionView)->Buffer()->Neuter();
+    inputBuffer.Reset();
+    inputViews.Reset();
+    actionView.Reset();
+    motionView.Reset();
+  }
+};
+
+static inline WindowState *GetWindowState(GLFWwindow *window) {
+  return (WindowState*) glfwGetWindowUserPointer(window);
+}
+
+// JS handle of a window, 0 for windows unknown to the binding
+static inline int HandleOf(GLFWwindow *window) {
+  WindowState *state=window ? GetWindowState(window) : NULL;
+  return state ? state->handle : 0;
+}
+
+// the main thread must not make the context of such a window current
+static inline bool OnRenderThread(WindowState *state) {
+  return state && state->renderer;
+}
+
+// reinstall the GLFW callbacks of one or all windows for the current consumers
+void UpdateCallbacks(GLFWwindow *window);
+void UpdateCallbacks();
+
+// delete the native state of all windows, before glfwTerminate
+void ReleaseWindowStates();
+
+// AntTweakBar consumes input events through the GLFW callbacks
+void SetTweakBarInput(bool active);
+
+} // namespace glfw
+
+#endif /* WINDOW_H_ */
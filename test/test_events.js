@@ -0,0 +1,70 @@
+var glfw = require('../index');
+var log = console.log;
+
+// Initialize GLFW
+if (!glfw.Init()) {
+  log("Failed to initialize GLFW");
+  process.exit(-1);
+}
+
+glfw.DefaultWindowHints();
+
+var width=640, height=480;
+var window=glfw.CreateWindow(width, height,"Event queue test");
+if (!window) {
+  log("Failed to open GLFW window");
+  glfw.Terminate();
+  process.exit(-1);
+}
+
+glfw.MakeContextCurrent(window);
+glfw.SwapInterval(0);
+
+// callbacks only store records, each PollEvents emits a single batch
+glfw.SetEventQueue(true);
+
+// one mousemove/resize per poll, scroll offsets summed
+glfw.SetEventCoalescing(glfw.EVENT_MOUSEMOVE, glfw.COALESCE_LATEST);
+glfw.SetEventCoalescing(glfw.EVENT_RESIZE, glfw.COALESCE_LATEST);
+glfw.SetEventCoalescing(glfw.EVENT_MOUSEWHEEL, glfw.COALESCE_SUM);
+
+// keep at most 64 records between two polls
+glfw.SetEventQueueLimit(64, glfw.QUEUE_DROP_COALESCIBLE);
+
+var names=[];
+names[glfw.EVENT_KEYDOWN]='keydown';
+names[glfw.EVENT_KEYUP]='keyup';
+names[glfw.EVENT_MOUSEMOVE]='mousemove';
+names[glfw.EVENT_MOUSEDOWN]='mousedown';
+names[glfw.EVENT_MOUSEUP]='mouseup';
+names[glfw.EVENT_MOUSEWHEEL]='mousewheel';
+names[glfw.EVENT_RESIZE]='resize';
+
+var stride=glfw.EVENT_RECORD_SIZE;
+glfw.events.on('events',function(batch) {
+  var count=batch.length/stride;
+  log("[events] "+count+" records");
+  for(var i=0;i<batch.length;i+=stride) {
+    var type=batch[i];
+    if(names[type])
+      log("  "+names[type]+" "+batch[i+2]+", "+batch[i+3]);
+  }
+});
+
+while(!glfw.WindowShouldClose(window) && !glfw.GetKey(window, glfw.KEY_ESCAPE)) {
+  var wsize = glfw.GetFramebufferSize(window);
+  glfw.testScene(wsize.width, wsize.height);
+
+  glfw.SwapBuffers(window);
+  glfw.PollEvents();
+}
+
+var stats=glfw.GetEventQueueStats();
+log("queue high water: "+stats.highWater);
+log("dropped: "+stats.dropped.join(','));
+log("coalesced: "+stats.coalesced.join(','));
+
+glfw.DestroyWindow(window);
+glfw.Terminate();
+
+process.exit(0);
@@ -0,0 +1,39 @@
+var glfw = require('../index');
+var log = console.log;
+
+// Initialize GLFW
+if (!glfw.Init()) {
+  log("Failed to initialize GLFW");
+  process.exit(-1);
+}
+
+glfw.DefaultWindowHints();
+
+var window=glfw.CreateWindow(640, 480, "Test RunLoop");
+if (!window) {
+  log("Failed to open GLFW window");
+  glfw.Terminate();
+  process.exit(-1);
+}
+
+glfw.MakeContextCurrent(window);
+glfw.SwapInterval(1);
+
+glfw.events.on('keydown',function(evt) {
+  if (evt.which == glfw.KEY_ESCAPE) glfw.StopLoop(window);
+});
+
+// the node event loop keeps running between frames
+var timer = setInterval(function() { log('timer still running'); }, 1000);
+
+// info: dt, time, fb width, fb height, frame index
+glfw.RunLoop(window, function(info) {
+  glfw.testScene(info[2], info[3]);
+  if (info[4] % 60 == 0) log('frame '+info[4]+' dt '+(info[0]*1000).toFixed(2)+' ms');
+}, {
+  done: function() {
+    clearInterval(timer);
+    glfw.DestroyWindow(window);
+    glfw.Terminate();
+  }
+});